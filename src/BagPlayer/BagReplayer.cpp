@@ -0,0 +1,200 @@
+#include "BagReplayer.h"
+
+#include <chrono>
+#include <thread>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/Imu.h>
+#include <ros/message_traits.h>
+
+namespace dso_vi
+{
+
+BagReplayer::BagReplayer(const std::string &bagFile, const std::string &imageTopic, const std::string &imuTopic,
+                         double offsetSec, double readAheadSec):
+    _view(NULL), _readAheadSec(readAheadSec), _readDone(false), _stopReading(false),
+    _imageCnt(0), _imuCnt(0), _bagDurationSec(0), _wallDurationSec(0),
+    _ioWaitCnt(0), _ioWaitSec(0)
+{
+    ROS_INFO("Playing bagfile: %s", bagFile.c_str());
+    _bag.open(bagFile, rosbag::bagmode::Read);
+
+    std::vector<std::string> topics;
+    topics.push_back(imageTopic);
+    topics.push_back(imuTopic);
+
+    rosbag::View tempBagView(_bag, rosbag::TopicQuery(topics));
+    ros::Time startTime = tempBagView.getBeginTime() + ros::Duration(offsetSec);
+
+    _view = new rosbag::View(_bag, rosbag::TopicQuery(topics), startTime, ros::TIME_MAX);
+    ROS_INFO("BAG starts at: %f", _view->getBeginTime().toSec());
+
+    // dispatch table, decided once per connection instead of per message
+    std::vector<const rosbag::ConnectionInfo*> connections = _view->getConnections();
+    for(const rosbag::ConnectionInfo* connection : connections)
+    {
+        StreamType stream = STREAM_NONE;
+        if(connection->topic == imageTopic && connection->datatype == ros::message_traits::datatype<sensor_msgs::Image>())
+            stream = STREAM_IMAGE;
+        else if(connection->topic == imuTopic && connection->datatype == ros::message_traits::datatype<sensor_msgs::Imu>())
+            stream = STREAM_IMU;
+        else
+            ROS_WARN("ignoring connection on %s of type %s", connection->topic.c_str(), connection->datatype.c_str());
+
+        if(connection->id >= _connectionStream.size())
+            _connectionStream.resize(connection->id + 1, STREAM_NONE);
+        _connectionStream[connection->id] = stream;
+    }
+}
+
+BagReplayer::~BagReplayer()
+{
+    delete _view;
+    _bag.close();
+}
+
+bool BagReplayer::readMsg(const rosbag::MessageInstance &m, ReplayMsg &msg) const
+{
+    const uint32_t id = m.getConnectionInfo()->id;
+    const StreamType stream = id < _connectionStream.size() ? _connectionStream[id] : STREAM_NONE;
+
+    if(stream == STREAM_IMAGE)
+        msg.image = m.instantiate<sensor_msgs::Image>();
+    else if(stream == STREAM_IMU)
+        msg.imu = m.instantiate<sensor_msgs::Imu>();
+    else
+        return false;
+
+    msg.time = m.getTime();
+    return true;
+}
+
+void BagReplayer::readLoop(void)
+{
+    for(rosbag::View::iterator it = _view->begin(); it != _view->end(); ++it)
+    {
+        ReplayMsg msg;
+        if(!readMsg(*it, msg))
+            continue;
+
+        unique_lock<mutex> lock(_mutexReadAhead);
+        // stay at most _readAheadSec of bag time ahead of the consumer
+        _condNotFull.wait(lock, [&]{return _stopReading || _readAhead.empty() ||
+                                           (msg.time - _readAhead.front().time).toSec() < _readAheadSec;});
+        if(_stopReading)
+            break;
+        _readAhead.push_back(msg);
+        lock.unlock();
+        _condNotEmpty.notify_one();
+    }
+
+    {
+        lock_guard<mutex> lock(_mutexReadAhead);
+        _readDone = true;
+    }
+    _condNotEmpty.notify_one();
+}
+
+bool BagReplayer::popMsg(ReplayMsg &msg)
+{
+    unique_lock<mutex> lock(_mutexReadAhead);
+    if(_readAhead.empty() && !_readDone)
+    {
+        // the tracker is waiting for I/O
+        std::chrono::steady_clock::time_point waitStart = std::chrono::steady_clock::now();
+        _condNotEmpty.wait(lock, [this]{return _readDone || !_readAhead.empty();});
+        _ioWaitSec += std::chrono::duration<double>(std::chrono::steady_clock::now() - waitStart).count();
+        _ioWaitCnt++;
+    }
+    if(_readAhead.empty())
+        return false;
+
+    msg = _readAhead.front();
+    _readAhead.pop_front();
+    lock.unlock();
+    _condNotFull.notify_one();
+    return true;
+}
+
+void BagReplayer::play(MsgSynchronizer &msgsync, const std::function<bool()> &onMessage)
+{
+    std::chrono::steady_clock::time_point wallStart = std::chrono::steady_clock::now();
+    ros::Time bagStart, bagEnd;
+    bool first = true;
+
+    // the view is walked by one thread only, begin() updates its state
+    std::thread readThread;
+    rosbag::View::iterator it;
+    if(_readAheadSec > 0)
+        readThread = std::thread(&BagReplayer::readLoop, this);
+    else
+        it = _view->begin();
+
+    while(true)
+    {
+        ReplayMsg msg;
+        if(_readAheadSec > 0)
+        {
+            if(!popMsg(msg))
+                break;
+        }
+        else
+        {
+            if(it == _view->end())
+                break;
+            bool valid = readMsg(*it, msg);
+            ++it;
+            if(!valid)
+                continue;
+        }
+
+        if(msg.image)
+        {
+            msgsync.imageCallback(msg.image);
+            _imageCnt++;
+        }
+        else
+        {
+            msgsync.imuCallback(msg.imu);
+            _imuCnt++;
+        }
+
+        if(first)
+        {
+            bagStart = msg.time;
+            first = false;
+        }
+        bagEnd = msg.time;
+
+        if(!onMessage())
+            break;
+    }
+
+    if(readThread.joinable())
+    {
+        {
+            lock_guard<mutex> lock(_mutexReadAhead);
+            _stopReading = true;
+        }
+        _condNotFull.notify_one();
+        readThread.join();
+    }
+
+    _wallDurationSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - wallStart).count();
+    _bagDurationSec = first ? 0 : (bagEnd - bagStart).toSec();
+}
+
+double BagReplayer::getReplaySpeed(void) const
+{
+    return _wallDurationSec > 0 ? _bagDurationSec / _wallDurationSec : 0;
+}
+
+void BagReplayer::printStats(void) const
+{
+    printf("replayed %.1fs of bag (%lu images, %lu imu) in %.1fs, %.2fx realtime\n",
+           _bagDurationSec, (unsigned long)_imageCnt, (unsigned long)_imuCnt, _wallDurationSec, getReplaySpeed());
+    if(_readAheadSec > 0)
+        printf("read-ahead %.0fms: tracker waited for I/O %lu times, %.3fs in total\n",
+               _readAheadSec*1000, (unsigned long)_ioWaitCnt, _ioWaitSec);
+}
+
+}
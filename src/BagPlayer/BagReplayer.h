@@ -0,0 +1,79 @@
+#ifndef BAGREPLAYER_H
+#define BAGREPLAYER_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+
+#include <rosbag/bag.h>
+#include <rosbag/view.h>
+
+#include "MsgSync/MsgSynchronizer.h"
+
+namespace dso_vi
+{
+// Plays the image and imu topics of a bag into a MsgSynchronizer as fast as the consumer allows.
+// Connections are resolved to a stream once, so each message is deserialized exactly once.
+// With a read-ahead depth > 0 a background thread reads and deserializes up to that much
+// bag time ahead of the consumer, so disk I/O and decompression don't stall tracking.
+class BagReplayer
+{
+public:
+    BagReplayer(const std::string &bagFile, const std::string &imageTopic, const std::string &imuTopic,
+                double offsetSec = 0, double readAheadSec = 0.3);
+    ~BagReplayer();
+
+    // after every message onMessage is called, playback stops when it returns false
+    void play(MsgSynchronizer &msgsync, const std::function<bool()> &onMessage);
+
+    // bag time played per wall time
+    double getReplaySpeed(void) const;
+    void printStats(void) const;
+
+private:
+    enum StreamType{
+        STREAM_NONE = 0,
+        STREAM_IMAGE,
+        STREAM_IMU
+    };
+
+    struct ReplayMsg
+    {
+        sensor_msgs::ImageConstPtr image;
+        sensor_msgs::ImuConstPtr imu;
+        ros::Time time;
+    };
+
+    // deserialize the message if it belongs to one of our streams
+    bool readMsg(const rosbag::MessageInstance &m, ReplayMsg &msg) const;
+    // read-ahead thread
+    void readLoop(void);
+    // consumer side, false once the bag is exhausted
+    bool popMsg(ReplayMsg &msg);
+
+    rosbag::Bag _bag;
+    rosbag::View *_view;
+    std::vector<StreamType> _connectionStream;  // indexed by connection id
+
+    double _readAheadSec;
+    std::deque<ReplayMsg> _readAhead;
+    std::mutex _mutexReadAhead;
+    std::condition_variable _condNotEmpty;
+    std::condition_variable _condNotFull;
+    bool _readDone;
+    bool _stopReading;
+
+    size_t _imageCnt;
+    size_t _imuCnt;
+    double _bagDurationSec;
+    double _wallDurationSec;
+    size_t _ioWaitCnt;        // times the consumer found the read-ahead buffer empty
+    double _ioWaitSec;
+};
+
+}
+
+#endif // BAGREPLAYER_H
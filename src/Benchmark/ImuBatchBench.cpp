@@ -0,0 +1,164 @@
+// Compares the per-sample imu path of the ingest stage with ImuBatch, preintegration included.
+// legacy: IMUData built one sample at a time with scaling, each sample fed to ImuPreintegrator.
+// batch:  ImuBatch::fill with vectorized scaling, ImuPreintegrator::integrate(batch) on its columns.
+// batch+imudata: as batch, plus the IMUData vector FullSystem::addActiveFrame still takes.
+// The spans are built like the synchronizer's, with the interpolated samples at both ends.
+//
+// usage: imu_batch_bench [seconds of data]
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include <Eigen/Core>
+
+#include "IMU/imudata.h"
+#include "MsgSync/MsgSynchronizer.h"
+#include "Pipeline/ImuBatch.h"
+#include "Pipeline/ImuPreintegrator.h"
+
+namespace
+{
+const double cameraRate = 20.0;
+const double g3dm = 9.80665;
+
+struct Result
+{
+    double nsPerSample;
+    double checksum;    // rotation angle summed over the frames, the same for all paths
+};
+
+dso_vi::ImuSample sampleOf(const sensor_msgs::Imu &msg)
+{
+    dso_vi::ImuSample sample;
+    sample.stampNs = (int64_t)msg.header.stamp.toNSec();
+    sample.angular_velocity = msg.angular_velocity;
+    sample.linear_acceleration = msg.linear_acceleration;
+    return sample;
+}
+
+// one sample at a time with scaling, like the ingest stage did
+void addImuData(std::vector<dso_vi::IMUData> &vimuData, const geometry_msgs::Vector3 &gyro,
+                const geometry_msgs::Vector3 &acc, int64_t stampNs)
+{
+    vimuData.push_back(dso_vi::IMUData(gyro.x, gyro.y, gyro.z, acc.x * g3dm, acc.y * g3dm, acc.z * g3dm, stampNs * 1e-9));
+}
+
+double rotationAngle(const dso_vi::ImuPreintegrator &preintegrator)
+{
+    return gtsam::Rot3::Logmap(preintegrator.deltaRij()).norm();
+}
+
+Result runLegacy(const std::vector<dso_vi::ImuMsgSpan> &frames, size_t samples)
+{
+    Result result = {0, 0};
+    dso_vi::ImuPreintegrator preintegrator;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(const dso_vi::ImuMsgSpan &span : frames)
+    {
+        std::vector<dso_vi::IMUData> vimuData;
+        vimuData.reserve(span.size() + 2);
+        addImuData(vimuData, span.front.angular_velocity, span.front.linear_acceleration, span.front.stampNs);
+        for(size_t i = 0; i < span.size(); i++)
+            addImuData(vimuData, span[i]->angular_velocity, span[i]->linear_acceleration, span.stampsNs[i]);
+        addImuData(vimuData, span.back.angular_velocity, span.back.linear_acceleration, span.back.stampNs);
+        preintegrator.reset(gtsam::imuBias::ConstantBias());
+        for(const dso_vi::IMUData &imudata : vimuData)
+            preintegrator.integrate(imudata._a, imudata._g, imudata._t);
+        result.checksum += rotationAngle(preintegrator);
+    }
+    result.nsPerSample = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples;
+    return result;
+}
+
+Result runBatch(const std::vector<dso_vi::ImuMsgSpan> &frames, size_t samples, bool buildImuData)
+{
+    Result result = {0, 0};
+    dso_vi::ImuBatch batch;
+    dso_vi::ImuPreintegrator preintegrator;
+    std::vector<dso_vi::IMUData> vimuData;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(const dso_vi::ImuMsgSpan &span : frames)
+    {
+        batch.fill(span, g3dm);
+        preintegrator.reset(gtsam::imuBias::ConstantBias());
+        preintegrator.integrate(batch);
+        result.checksum += rotationAngle(preintegrator);
+
+        if(buildImuData)
+        {
+            vimuData.clear();
+            vimuData.reserve(batch.size());
+            for(size_t i = 0; i < batch.size(); i++)
+            {
+                vimuData.push_back(dso_vi::IMUData(
+                    batch.gyro()(i,0), batch.gyro()(i,1), batch.gyro()(i,2),
+                    batch.acc()(i,0), batch.acc()(i,1), batch.acc()(i,2),
+                    batch.t()(i)));
+            }
+        }
+    }
+    result.nsPerSample = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count() / samples;
+    return result;
+}
+}
+
+int main(int argc, char** argv)
+{
+    const double seconds = argc > 1 ? atof(argv[1]) : 60.0;
+    const double imuRates[] = {200.0, 1000.0, 4000.0};
+
+    printf("%10s %10s %14s %14s %16s\n", "imu rate", "samples", "legacy ns/smp", "batch ns/smp", "+imudata ns/smp");
+    for(double imuRate : imuRates)
+    {
+        const size_t samples = (size_t)(seconds * imuRate);
+        const size_t perFrame = (size_t)(imuRate / cameraRate);
+
+        std::vector<sensor_msgs::ImuConstPtr> msgs;
+        std::vector<int64_t> stampsNs;
+        for(size_t i = 0; i < samples; i++)
+        {
+            sensor_msgs::ImuPtr msg(new sensor_msgs::Imu());
+            msg->header.stamp.fromNSec(1000000000000ULL + (uint64_t)(i * 1e9 / imuRate));
+            msg->angular_velocity.x = 0.01 * (i % 7);
+            msg->angular_velocity.y = 0.02;
+            msg->angular_velocity.z = -0.01;
+            msg->linear_acceleration.x = 0.1;
+            msg->linear_acceleration.y = 0.0;
+            msg->linear_acceleration.z = 1.0;
+            msgs.push_back(msg);
+            stampsNs.push_back((int64_t)msg->header.stamp.toNSec());
+        }
+
+        // same spans as the synchronizer hands out: the images fall on every perFrame-th message,
+        // that message is the back sample of one interval and the front of the next
+        std::vector<dso_vi::ImuMsgSpan> frames;
+        for(size_t i = 0; i + perFrame < samples; i += perFrame)
+        {
+            dso_vi::ImuMsgSpan span;
+            span.msgs = msgs.data() + i + 1;
+            span.stampsNs = stampsNs.data() + i + 1;
+            span.count = perFrame - 1;
+            span.hasFront = true;
+            span.front = sampleOf(*msgs[i]);
+            span.back = sampleOf(*msgs[i + perFrame]);
+            frames.push_back(span);
+        }
+        const size_t used = frames.size() * (perFrame + 1);
+
+        // warm up, then measure
+        runLegacy(frames, used);
+        runBatch(frames, used, true);
+        Result legacy = runLegacy(frames, used);
+        Result batch = runBatch(frames, used, false);
+        Result batchImuData = runBatch(frames, used, true);
+
+        printf("%8.0fHz %10lu %14.2f %14.2f %16.2f%s\n", imuRate, (unsigned long)used,
+               legacy.nsPerSample, batch.nsPerSample, batchImuData.nsPerSample,
+               std::abs(legacy.checksum - batch.checksum) > 1e-9 * std::abs(legacy.checksum) ? "  (checksum mismatch!)" : "");
+    }
+
+    return 0;
+}
@@ -0,0 +1,255 @@
+// Regression benchmark over the EuRoC sequences listed under benchmark.* in the config.
+// Each sequence is replayed by a dso_live process of its own (DSO keeps its state in globals),
+// with latency=1 and the run log next to the results. Per sequence it records
+// throughput, tracking time and end-to-end latency percentiles from the log, the peak RSS
+// of the process and the trajectory error against the ground truth (see TrajectoryMetrics).
+// The results are written as one json object, so runs can be compared over time.
+//
+// usage: dso_benchmark <config yaml> <results json> calib=XXX [further dso_live arguments]
+//   the sequence logs (<name>.log) and outputs (<name>.out) go next to the results
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <opencv2/core/core.hpp>
+
+#include "IMU/configparam.h"
+#include "Eval/GroundTruthCache.h"
+#include "Eval/TrajectoryMetrics.h"
+#include "Log/LogReader.h"
+#include "Util/LatencyHistogram.h"
+
+using namespace dso_vi;
+
+namespace
+{
+struct ProcessResult
+{
+    int exitCode;
+    double wallSec;
+    long peakRssKb;
+};
+
+std::string directoryOf(const std::string &path)
+{
+    const size_t slash = path.rfind('/');
+    return slash == std::string::npos ? std::string(".") : path.substr(0, slash);
+}
+
+bool fileExists(const std::string &path)
+{
+    struct stat st;
+    return stat(path.c_str(), &st) == 0;
+}
+
+// dso_live is installed next to this executable
+std::string findDsoLive(void)
+{
+    char self[4096];
+    const ssize_t len = readlink("/proc/self/exe", self, sizeof(self) - 1);
+    if(len <= 0)
+        return "dso_live";
+    self[len] = 0;
+    return directoryOf(self) + "/dso_live";
+}
+
+// runs binary with args, stdout and stderr to outputFile, false if it couldn't be started
+bool runProcess(const std::string &binary, const std::vector<std::string> &args,
+                const std::string &outputFile, ProcessResult &result)
+{
+    std::vector<char*> argv;
+    argv.push_back(const_cast<char*>(binary.c_str()));
+    for(const std::string &arg : args)
+        argv.push_back(const_cast<char*>(arg.c_str()));
+    argv.push_back(0);
+
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    const pid_t pid = fork();
+    if(pid < 0)
+        return false;
+    if(pid == 0)
+    {
+        const int fd = open(outputFile.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if(fd >= 0)
+        {
+            dup2(fd, STDOUT_FILENO);
+            dup2(fd, STDERR_FILENO);
+            close(fd);
+        }
+        execv(binary.c_str(), &argv[0]);
+        _exit(127);
+    }
+
+    int status = 0;
+    struct rusage usage;
+    if(wait4(pid, &status, 0, &usage) != pid)
+        return false;
+    result.wallSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.exitCode = WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status);
+    // kilobytes on linux
+    result.peakRssKb = usage.ru_maxrss;
+    return result.exitCode != 127;
+}
+
+void writeLatencyJson(FILE* out, const char* name, const LatencyHistogram &histogram)
+{
+    fprintf(out, "\"%s\": {\"count\": %lu, \"mean\": %.4f, \"p50\": %.4f, \"p90\": %.4f, \"p99\": %.4f, \"max\": %.4f}",
+            name, (unsigned long)histogram.getCount(), histogram.getMean() * 1e-6,
+            histogram.getPercentile(0.5) * 1e-6, histogram.getPercentile(0.9) * 1e-6,
+            histogram.getPercentile(0.99) * 1e-6, histogram.getMax() * 1e-6);
+}
+
+// one entry of the "sequences" array, false if the sequence failed
+bool benchmarkSequence(const std::string &name, const std::string &bagFile, const std::string &groundTruthFile,
+                       const std::string &outputDir, const std::string &dsoLive, const std::string &configFile,
+                       const std::vector<std::string> &extraArgs, const gtsam::Pose3 &bodyToCamera, FILE* out)
+{
+    fprintf(out, "{\"name\": \"%s\", ", name.c_str());
+    if(!fileExists(bagFile) || !fileExists(groundTruthFile))
+    {
+        printf("%-18s bag or ground truth missing, skipped\n", name.c_str());
+        fprintf(out, "\"ok\": false, \"error\": \"bag or ground truth missing\"}");
+        return false;
+    }
+
+    const std::string logFile = outputDir + "/" + name + ".log";
+    std::vector<std::string> args(extraArgs);
+    args.push_back("config=" + configFile);
+    args.push_back("bag=" + bagFile);
+    args.push_back("groundtruth=" + groundTruthFile);
+    args.push_back("log=" + logFile);
+    args.push_back("latency=1");
+    args.push_back("nogui=1");
+    args.push_back("quiet=1");
+
+    ProcessResult process;
+    if(!runProcess(dsoLive, args, outputDir + "/" + name + ".out", process))
+    {
+        printf("%-18s could not run %s\n", name.c_str(), dsoLive.c_str());
+        fprintf(out, "\"ok\": false, \"error\": \"could not run dso_live\"}");
+        return false;
+    }
+
+    // timings from the log, a second pass does the trajectory
+    LatencyHistogram trackTime, latency;
+    size_t frameCnt = 0, trackedCnt = 0;
+    {
+        LogReader reader(logFile);
+        LogFrameTiming timing;
+        LogFrameLatency frameLatency;
+        while(reader.next())
+        {
+            if(reader.get(timing))
+            {
+                frameCnt++;
+                trackedCnt += timing.tracked ? 1 : 0;
+                trackTime.record((int64_t)(timing.trackSec * 1e9));
+            }
+            else if(reader.get(frameLatency))
+                latency.record((int64_t)(frameLatency.latencySec * 1e9));
+        }
+    }
+
+    TrajectoryMetrics metrics;
+    TrajectoryMetrics::Summary summary;
+    {
+        LogReader reader(logFile);
+        GroundTruthCache groundTruth(groundTruthFile);
+        metrics.addLog(reader, groundTruth, bodyToCamera);
+    }
+    const bool aligned = metrics.compute(summary);
+    const bool ok = process.exitCode == 0 && aligned;
+
+    fprintf(out, "\"ok\": %s, \"exit_code\": %d, \"wall_sec\": %.3f, \"peak_rss_mb\": %.1f, ",
+            ok ? "true" : "false", process.exitCode, process.wallSec, process.peakRssKb / 1024.0);
+    fprintf(out, "\"frames\": %lu, \"tracked_frames\": %lu, \"fps\": %.3f, ",
+            (unsigned long)frameCnt, (unsigned long)trackedCnt, frameCnt / process.wallSec);
+    writeLatencyJson(out, "track_ms", trackTime);
+    fprintf(out, ", ");
+    writeLatencyJson(out, "latency_ms", latency);
+    fprintf(out, ", \"trajectory\": ");
+    TrajectoryMetrics::writeJson(out, summary);
+    fprintf(out, "}");
+
+    printf("%-18s %s  %5lu frames  %6.2f fps  latency p50 %7.2fms p99 %7.2fms  rss %6.1fMB  ate rmse %.4fm\n",
+           name.c_str(), ok ? "ok    " : "FAILED", (unsigned long)frameCnt, frameCnt / process.wallSec,
+           latency.getPercentile(0.5) * 1e-6, latency.getPercentile(0.99) * 1e-6,
+           process.peakRssKb / 1024.0, summary.ate.rmse);
+    return ok;
+}
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3)
+    {
+        printf("usage: dso_benchmark <config yaml> <results json> calib=XXX [further dso_live arguments]\n");
+        return 1;
+    }
+    const std::string configFile = argv[1];
+    const std::string resultsFile = argv[2];
+    const std::string outputDir = directoryOf(resultsFile);
+    std::vector<std::string> extraArgs(argv + 3, argv + argc);
+
+    std::string bagDir, groundTruthDir;
+    std::vector<std::string> sequences;
+    {
+        cv::FileStorage fSettings(configFile, cv::FileStorage::READ);
+        if(!fSettings.isOpened())
+        {
+            printf("could not read %s\n", configFile.c_str());
+            return 1;
+        }
+        bagDir = (std::string)fSettings["benchmark.BagDir"];
+        groundTruthDir = (std::string)fSettings["benchmark.GroundTruthDir"];
+        cv::FileNode sequenceNode = fSettings["benchmark.Sequences"];
+        for(cv::FileNodeIterator it = sequenceNode.begin(); it != sequenceNode.end(); ++it)
+            sequences.push_back((std::string)*it);
+    }
+    if(sequences.empty())
+    {
+        printf("no benchmark.Sequences in %s\n", configFile.c_str());
+        return 1;
+    }
+
+    ConfigParam config(configFile);
+    const Eigen::Matrix4d Tbc = config.GetEigTbc();
+    const gtsam::Pose3 bodyToCamera(gtsam::Rot3(Eigen::Matrix3d(Tbc.block<3,3>(0,0))), gtsam::Point3(Tbc.block<3,1>(0,3)));
+
+    FILE* out = fopen(resultsFile.c_str(), "w");
+    if(!out)
+    {
+        printf("could not create %s\n", resultsFile.c_str());
+        return 1;
+    }
+
+    const std::string dsoLive = findDsoLive();
+    fprintf(out, "{\"time\": %ld, \"config\": \"%s\", \"sequences\": [", (long)time(0), configFile.c_str());
+    int failedCnt = 0;
+    for(size_t i = 0; i < sequences.size(); i++)
+    {
+        const std::string &name = sequences[i];
+        if(i > 0)
+            fprintf(out, ", ");
+        if(!benchmarkSequence(name, bagDir + "/" + name + ".bag",
+                              groundTruthDir + "/" + name + "/mav0/state_groundtruth_estimate0/data.csv",
+                              outputDir, dsoLive, configFile, extraArgs, bodyToCamera, out))
+            failedCnt++;
+        fflush(out);
+    }
+    fprintf(out, "]}\n");
+    fclose(out);
+
+    printf("%lu sequences, %d failed, results in %s\n", (unsigned long)sequences.size(), failedCnt, resultsFile.c_str());
+    return failedCnt == 0 ? 0 : 2;
+}
@@ -0,0 +1,268 @@
+// Microbenchmark of MsgSynchronizer's hot path: addImuMsg/addImageMsg on the producer threads,
+// getRecentMsgs/waitForMsgs on a consumer thread, fed from a SyntheticStream.
+// producers=1 pushes both streams from one thread in arrival order, like a single-threaded spinner.
+// With more, the imu and the image messages are pushed concurrently by their own threads, as the
+// callbacks of the nodelet's multi-threaded node handle do. The synchronizer takes a single producer
+// per stream, so the threads of one stream take turns in its order, the streams never wait on each other.
+// Reports the messages the synchronizer accepted per second, from the first push to the last bundle,
+// the push rate of each stream (messages per second until its last push) and the consumer
+// latency, image pushed -> handed out by getRecentMsgs. Every bundle goes through
+// SyncChecker. Without pacing (realtime=0) the producers push as fast as they can: small rings
+// overflow and the latency includes the backlog. realtime=1 paces the messages by their arrival time.
+//
+// Another implementation with the same interface can be measured by changing the Synchronizer
+// typedef; label= tags its rows so that the results of different builds can be put side by side.
+//
+// usage: sync_bench [key=value ...]
+//   producers=1 imu_rate=200 camera_rate=20 depth=4096 (ring buffer size of both streams)
+//   duration=10 (seconds of data) realtime=0 label=msgsync csv=<file>
+//   producers > 1 are split between the streams, the imu gets the extra one of an odd count
+//   sweep=1 runs producers 1,2,4,8 x imu_rate 200,1000,4000 x depth 2,64,4096 instead
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Benchmark/SyntheticStream.h"
+#include "MsgSync/MsgSynchronizer.h"
+#include "Util/LatencyHistogram.h"
+
+using namespace dso_vi;
+
+namespace
+{
+typedef MsgSynchronizer Synchronizer;
+
+struct BenchConfig
+{
+    int producerCnt;
+    double imuRate;
+    double cameraRate;
+    size_t depth;
+    double durationSec;
+    double realTimeFactor;
+};
+
+// the messages of one or both streams, pushed in order by producerCnt threads taking turns
+struct ProducerGroup
+{
+    std::vector<const SyntheticStream::Msg*> msgs;
+    size_t producerCnt;
+    std::atomic<size_t> turn;
+    // time of the last push of each stream, set by the thread that pushes it
+    std::atomic<int64_t> imuEndNs;
+    std::atomic<int64_t> imageEndNs;
+};
+
+void produce(Synchronizer &msgsync, ProducerGroup &group, size_t producer, double realTimeFactor,
+             std::chrono::steady_clock::time_point start, size_t lastImu, size_t lastImage)
+{
+    for(size_t i = producer; i < group.msgs.size(); i += group.producerCnt)
+    {
+        const SyntheticStream::Msg &msg = *group.msgs[i];
+        if(realTimeFactor > 0)
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(msg.arrivalSec / realTimeFactor)));
+
+        // spin briefly, the previous message of the group is usually being pushed right now
+        for(int spin = 0; group.turn.load(std::memory_order_acquire) != i; spin++)
+        {
+            if(spin > 64)
+                std::this_thread::yield();
+        }
+        if(msg.image)
+            msgsync.addImageMsg(msg.image);
+        else
+            msgsync.addImuMsg(msg.imu);
+        if(i == lastImu)
+            group.imuEndNs.store(latencyNowNs(), std::memory_order_relaxed);
+        if(i == lastImage)
+            group.imageEndNs.store(latencyNowNs(), std::memory_order_relaxed);
+        group.turn.store(i + 1, std::memory_order_release);
+    }
+}
+
+void writeHeader(FILE* out)
+{
+    fprintf(out, "label,producers,imu_hz,depth,msgs,accepted,sec,msgs_per_s,imu_push_per_s,image_push_per_s,"
+                 "latency_p50_us,latency_p99_us,latency_max_us,bundles,imu_overflow,image_overflow,imu_late,errors\n");
+}
+
+// one row of results, false if a bundle broke an invariant
+bool runBench(const std::string &label, const BenchConfig &bench, FILE* csv)
+{
+    SyntheticStream::Config config;
+    config.durationSec = bench.durationSec;
+    config.imuRate = bench.imuRate;
+    config.cameraRate = bench.cameraRate;
+    const SyntheticStream stream(config);
+    const std::vector<SyntheticStream::Msg> &msgs = stream.getMsgs();
+
+    Synchronizer msgsync(config.imageDelaySec, bench.depth, bench.depth);
+    msgsync.setStampArrival(true);
+    SyncChecker checker(config, config.imageDelaySec);
+    LatencyHistogram latency;
+    std::atomic<bool> producersDone(false);
+
+    // one group with both streams, or one per stream
+    const bool concurrent = bench.producerCnt > 1;
+    ProducerGroup groups[2];
+    size_t imuCnt = 0, imageCnt = 0;
+    for(const SyntheticStream::Msg &msg : msgs)
+    {
+        groups[concurrent && msg.image ? 1 : 0].msgs.push_back(&msg);
+        (msg.image ? imageCnt : imuCnt)++;
+    }
+    groups[0].producerCnt = concurrent ? bench.producerCnt - bench.producerCnt / 2 : bench.producerCnt;
+    groups[1].producerCnt = concurrent ? bench.producerCnt / 2 : 0;
+    for(ProducerGroup &group : groups)
+    {
+        group.turn.store(0);
+        group.imuEndNs.store(0);
+        group.imageEndNs.store(0);
+    }
+
+    const int64_t startNs = latencyNowNs();
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::thread consumer([&]()
+    {
+        sensor_msgs::ImageConstPtr image;
+        ImuMsgSpan span;
+        while(true)
+        {
+            // everything is pushed once this is set, a get after it sees all messages
+            const bool done = producersDone.load(std::memory_order_acquire);
+            if(msgsync.getRecentMsgs(image, span))
+            {
+                latency.record(latencyNowNs() - msgsync.getLastImageArrivalNs());
+                checker.check(image, span);
+                continue;
+            }
+            if(done)
+                break;
+            msgsync.waitForMsgs(0.01);
+        }
+    });
+
+    std::vector<std::thread> producers;
+    for(ProducerGroup &group : groups)
+    {
+        // index of the last message of each stream in the group, none if it has no such message
+        size_t lastImu = group.msgs.size(), lastImage = group.msgs.size();
+        for(size_t i = 0; i < group.msgs.size(); i++)
+            (group.msgs[i]->image ? lastImage : lastImu) = i;
+        for(size_t i = 0; i < group.producerCnt; i++)
+            producers.push_back(std::thread(produce, std::ref(msgsync), std::ref(group), i,
+                                            bench.realTimeFactor, start, lastImu, lastImage));
+    }
+    for(std::thread &producer : producers)
+        producer.join();
+    producersDone.store(true, std::memory_order_release);
+    msgsync.shutdown();
+    consumer.join();
+    const double sec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t acceptedCnt = msgs.size() - msgsync.getImuOverflowCnt() - msgsync.getImageOverflowCnt();
+    const double imuPushSec = (groups[0].imuEndNs.load() - startNs) * 1e-9;
+    const double imagePushSec = (std::max(groups[0].imageEndNs.load(), groups[1].imageEndNs.load()) - startNs) * 1e-9;
+
+    char row[512];
+    snprintf(row, sizeof(row), "%s,%d,%.0f,%lu,%lu,%lu,%.4f,%.0f,%.0f,%.0f,%.2f,%.2f,%.2f,%lu,%lu,%lu,%lu,%lu\n",
+             label.c_str(), bench.producerCnt, bench.imuRate, (unsigned long)bench.depth,
+             (unsigned long)msgs.size(), (unsigned long)acceptedCnt, sec, acceptedCnt / sec,
+             imuPushSec > 0 ? imuCnt / imuPushSec : 0, imagePushSec > 0 ? imageCnt / imagePushSec : 0,
+             latency.getPercentile(0.5) * 1e-3, latency.getPercentile(0.99) * 1e-3, latency.getMax() * 1e-3,
+             (unsigned long)checker.getBundleCnt(), (unsigned long)msgsync.getImuOverflowCnt(),
+             (unsigned long)msgsync.getImageOverflowCnt(), (unsigned long)msgsync.getImuLateCnt(),
+             (unsigned long)checker.getErrorCnt());
+    fputs(row, stdout);
+    fflush(stdout);
+    if(csv)
+        fputs(row, csv);
+    return checker.getErrorCnt() == 0;
+}
+}
+
+int main(int argc, char** argv)
+{
+    BenchConfig bench = {1, 200.0, 20.0, 4096, 10.0, 0.0};
+    std::string label = "msgsync";
+    std::string csvFile;
+    int sweep = 0;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        unsigned long depth;
+        char buf[256];
+        if(1 == sscanf(arg, "producers=%d", &bench.producerCnt)) continue;
+        if(1 == sscanf(arg, "imu_rate=%lf", &bench.imuRate)) continue;
+        if(1 == sscanf(arg, "camera_rate=%lf", &bench.cameraRate)) continue;
+        if(1 == sscanf(arg, "duration=%lf", &bench.durationSec)) continue;
+        if(1 == sscanf(arg, "realtime=%lf", &bench.realTimeFactor)) continue;
+        if(1 == sscanf(arg, "sweep=%d", &sweep)) continue;
+        if(1 == sscanf(arg, "depth=%lu", &depth))
+        {
+            bench.depth = depth;
+            continue;
+        }
+        if(1 == sscanf(arg, "label=%255s", buf))
+        {
+            label = buf;
+            continue;
+        }
+        if(1 == sscanf(arg, "csv=%255s", buf))
+        {
+            csvFile = buf;
+            continue;
+        }
+        printf("could not parse argument %s\n", arg);
+        return 1;
+    }
+    if(bench.producerCnt < 1)
+        bench.producerCnt = 1;
+
+    FILE* csv = 0;
+    if(!csvFile.empty())
+    {
+        csv = fopen(csvFile.c_str(), "w");
+        if(!csv)
+        {
+            printf("could not create %s\n", csvFile.c_str());
+            return 1;
+        }
+        writeHeader(csv);
+    }
+    writeHeader(stdout);
+
+    bool ok = true;
+    if(sweep)
+    {
+        const int producerCnts[] = {1, 2, 4, 8};
+        const double imuRates[] = {200.0, 1000.0, 4000.0};
+        const size_t depths[] = {2, 64, 4096};
+        for(int producerCnt : producerCnts)
+            for(double imuRate : imuRates)
+                for(size_t depth : depths)
+                {
+                    BenchConfig run = bench;
+                    run.producerCnt = producerCnt;
+                    run.imuRate = imuRate;
+                    run.depth = depth;
+                    ok = runBench(label, run, csv) && ok;
+                }
+    }
+    else
+    {
+        ok = runBench(label, bench, csv);
+    }
+
+    if(csv)
+        fclose(csv);
+    return ok ? 0 : 2;
+}
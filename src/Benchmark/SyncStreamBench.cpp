@@ -0,0 +1,107 @@
+// Feeds a SyntheticStream into MsgSynchronizer and checks every bundle it hands out (SyncChecker),
+// no bag needed. Like BagReplayer, the bundles are fetched after each message on the same thread.
+// Reports the sync throughput, the imu messages delivered against the ones sent (a message at
+// an image stamp is only delivered as the interpolated end) and the largest error of the
+// interpolated back samples against the true signal at the exposure.
+//
+// usage: sync_stream_bench [key=value ...]
+//   duration=60 imu_rate=200 camera_rate=20 delay=0 (Camera.delaytoimu of the stream)
+//   sync_delay=<delay> (of the synchronizer) jitter=0 imu_drop=0 image_drop=0 reorder=0
+//   imu_gap=start:duration image_gap=start:duration (seconds, repeatable) width=0 height=0
+//   seed=1 realtime=0 (pacing factor, 0 as fast as possible) imu_buffer=4096 image_buffer=64
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "Benchmark/SyntheticStream.h"
+#include "MsgSync/MsgSynchronizer.h"
+
+using namespace dso_vi;
+
+namespace
+{
+bool parseGap(const char* value, SyntheticStream::Gap &gap)
+{
+    return sscanf(value, "%lf:%lf", &gap.startSec, &gap.durationSec) == 2;
+}
+}
+
+int main(int argc, char** argv)
+{
+    SyntheticStream::Config config;
+    double syncDelaySec = -1;
+    double realTimeFactor = 0;
+    int imuBufferSize = 4096, imageBufferSize = 64;
+
+    for(int i = 1; i < argc; i++)
+    {
+        const char* arg = argv[i];
+        SyntheticStream::Gap gap;
+        if(1 == sscanf(arg, "duration=%lf", &config.durationSec)) continue;
+        if(1 == sscanf(arg, "imu_rate=%lf", &config.imuRate)) continue;
+        if(1 == sscanf(arg, "camera_rate=%lf", &config.cameraRate)) continue;
+        if(1 == sscanf(arg, "delay=%lf", &config.imageDelaySec)) continue;
+        if(1 == sscanf(arg, "sync_delay=%lf", &syncDelaySec)) continue;
+        if(1 == sscanf(arg, "jitter=%lf", &config.arrivalJitterSec)) continue;
+        if(1 == sscanf(arg, "imu_drop=%lf", &config.imuDropRate)) continue;
+        if(1 == sscanf(arg, "image_drop=%lf", &config.imageDropRate)) continue;
+        if(1 == sscanf(arg, "reorder=%lf", &config.imuReorderRate)) continue;
+        if(1 == sscanf(arg, "width=%d", &config.imageWidth)) continue;
+        if(1 == sscanf(arg, "height=%d", &config.imageHeight)) continue;
+        if(1 == sscanf(arg, "seed=%u", &config.seed)) continue;
+        if(1 == sscanf(arg, "realtime=%lf", &realTimeFactor)) continue;
+        if(1 == sscanf(arg, "imu_buffer=%d", &imuBufferSize)) continue;
+        if(1 == sscanf(arg, "image_buffer=%d", &imageBufferSize)) continue;
+        if(0 == strncmp(arg, "imu_gap=", 8) && parseGap(arg + 8, gap))
+        {
+            config.imuGaps.push_back(gap);
+            continue;
+        }
+        if(0 == strncmp(arg, "image_gap=", 10) && parseGap(arg + 10, gap))
+        {
+            config.imageGaps.push_back(gap);
+            continue;
+        }
+        printf("could not parse argument %s\n", arg);
+        return 1;
+    }
+    if(syncDelaySec < 0)
+        syncDelaySec = config.imageDelaySec;
+
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    SyntheticStream stream(config);
+    const double generateSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%lu imu messages (%lu dropped, %lu reordered), %lu images (%lu dropped), generated in %.3fs\n",
+           (unsigned long)stream.getImuCnt(), (unsigned long)stream.getImuDroppedCnt(),
+           (unsigned long)stream.getImuReorderedCnt(), (unsigned long)stream.getImageCnt(),
+           (unsigned long)stream.getImageDroppedCnt(), generateSec);
+
+    MsgSynchronizer msgsync(syncDelaySec, imageBufferSize, imuBufferSize);
+    SyncChecker checker(config, syncDelaySec);
+    sensor_msgs::ImageConstPtr image;
+    ImuMsgSpan span;
+
+    start = std::chrono::steady_clock::now();
+    stream.play(msgsync, realTimeFactor, [&]()
+    {
+        while(msgsync.getRecentMsgs(image, span))
+            checker.check(image, span);
+        return true;
+    });
+    const double playSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    const size_t msgCnt = stream.getMsgs().size();
+
+    printf("%lu messages in %.3fs, %.0f msgs/s, %.1fns per message\n",
+           (unsigned long)msgCnt, playSec, msgCnt / playSec, playSec * 1e9 / msgCnt);
+    printf("%lu bundles, %lu resets, imu delivered %lu of %lu, late %lu, overflow imu %lu image %lu\n",
+           (unsigned long)checker.getBundleCnt(), (unsigned long)checker.getResetCnt(),
+           (unsigned long)checker.getImuCnt(), (unsigned long)stream.getImuCnt(),
+           (unsigned long)msgsync.getImuLateCnt(), (unsigned long)msgsync.getImuOverflowCnt(),
+           (unsigned long)msgsync.getImageOverflowCnt());
+    printf("max interpolation error %.3g rad/s, %lu check errors\n",
+           checker.getMaxInterpolationError(), (unsigned long)checker.getErrorCnt());
+    return checker.getErrorCnt() == 0 ? 0 : 2;
+}
@@ -0,0 +1,219 @@
+#include "SyntheticStream.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <limits>
+#include <random>
+#include <thread>
+
+#include <boost/make_shared.hpp>
+
+namespace dso_vi
+{
+
+namespace
+{
+ros::Time stampOf(double sec)
+{
+    ros::Time stamp;
+    stamp.fromNSec((uint64_t)llround(sec * 1e9));
+    return stamp;
+}
+
+bool arrivesBefore(const SyntheticStream::Msg &a, const SyntheticStream::Msg &b)
+{
+    return a.arrivalSec < b.arrivalSec;
+}
+}
+
+SyntheticStream::Config::Config():
+    durationSec(60.0), imuRate(200.0), cameraRate(20.0), startSec(1000.0),
+    imageDelaySec(0.0), imuLatencySec(0.001), imageLatencySec(0.01), arrivalJitterSec(0.0),
+    imuDropRate(0.0), imageDropRate(0.0), imuReorderRate(0.0),
+    imageWidth(0), imageHeight(0), seed(1)
+{
+}
+
+SyntheticStream::SyntheticStream(const Config &config):
+    _config(config), _imuCnt(0), _imageCnt(0), _imuDroppedCnt(0), _imageDroppedCnt(0), _imuReorderedCnt(0)
+{
+    std::mt19937 rng(config.seed);
+    std::uniform_real_distribution<double> uniform(0.0, 1.0);
+
+    // imu, the first sample is at startSec
+    const size_t imuTotal = (size_t)(config.durationSec * config.imuRate);
+    std::vector<Msg> imuMsgs;
+    imuMsgs.reserve(imuTotal);
+    for(size_t i = 0; i < imuTotal; i++)
+    {
+        const double sec = i / config.imuRate;
+        if(inGap(config.imuGaps, sec))
+            continue;
+        if(uniform(rng) < config.imuDropRate)
+        {
+            _imuDroppedCnt++;
+            continue;
+        }
+
+        Eigen::Vector3d gyro, acc;
+        getImuSignal(config.startSec + sec, gyro, acc);
+        sensor_msgs::ImuPtr imu = boost::make_shared<sensor_msgs::Imu>();
+        imu->header.seq = (uint32_t)i;
+        imu->header.stamp = stampOf(config.startSec + sec);
+        imu->angular_velocity.x = gyro.x();
+        imu->angular_velocity.y = gyro.y();
+        imu->angular_velocity.z = gyro.z();
+        imu->linear_acceleration.x = acc.x();
+        imu->linear_acceleration.y = acc.y();
+        imu->linear_acceleration.z = acc.z();
+
+        Msg msg;
+        msg.arrivalSec = sec + config.imuLatencySec + config.arrivalJitterSec * uniform(rng);
+        msg.imu = imu;
+        imuMsgs.push_back(msg);
+    }
+    // a reordered message arrives right after its successor
+    for(size_t i = 0; i + 1 < imuMsgs.size(); i++)
+    {
+        if(uniform(rng) < config.imuReorderRate)
+        {
+            std::swap(imuMsgs[i].arrivalSec, imuMsgs[i+1].arrivalSec);
+            _imuReorderedCnt++;
+            i++;
+        }
+    }
+    _imuCnt = imuMsgs.size();
+
+    // images, exposed at camera rate in imu time and stamped with the delay
+    const size_t imageTotal = (size_t)(config.durationSec * config.cameraRate);
+    _msgs.reserve(imuMsgs.size() + imageTotal);
+    for(size_t j = 0; j < imageTotal; j++)
+    {
+        const double sec = j / config.cameraRate;
+        if(inGap(config.imageGaps, sec))
+            continue;
+        if(uniform(rng) < config.imageDropRate)
+        {
+            _imageDroppedCnt++;
+            continue;
+        }
+
+        sensor_msgs::ImagePtr image = boost::make_shared<sensor_msgs::Image>();
+        image->header.seq = (uint32_t)j;
+        image->header.stamp = stampOf(config.startSec + sec + config.imageDelaySec);
+        image->width = config.imageWidth;
+        image->height = config.imageHeight;
+        image->encoding = "mono8";
+        image->is_bigendian = 0;
+        image->step = config.imageWidth;
+        image->data.assign((size_t)config.imageWidth * config.imageHeight, (uint8_t)(j & 0xff));
+
+        Msg msg;
+        msg.arrivalSec = sec + config.imageLatencySec + config.arrivalJitterSec * uniform(rng);
+        msg.image = image;
+        _msgs.push_back(msg);
+    }
+    _imageCnt = _msgs.size();
+
+    _msgs.insert(_msgs.end(), imuMsgs.begin(), imuMsgs.end());
+    std::stable_sort(_msgs.begin(), _msgs.end(), arrivesBefore);
+}
+
+bool SyntheticStream::inGap(const std::vector<Gap> &gaps, double sec)
+{
+    for(const Gap &gap : gaps)
+    {
+        if(sec >= gap.startSec && sec < gap.startSec + gap.durationSec)
+            return true;
+    }
+    return false;
+}
+
+void SyntheticStream::getImuSignal(double t, Eigen::Vector3d &gyro, Eigen::Vector3d &acc)
+{
+    // slow enough for linear interpolation between 200Hz samples to be accurate
+    const double w = 2.0 * M_PI;
+    gyro << 0.5 * std::sin(w * 0.5 * t), 0.3 * std::sin(w * 0.3 * t + 1.0), 0.2 * std::sin(w * 0.7 * t + 2.0);
+    acc << 0.5 * std::sin(w * 0.4 * t), 0.4 * std::cos(w * 0.6 * t), 9.81 + 0.3 * std::sin(w * 0.2 * t);
+}
+
+void SyntheticStream::play(MsgSynchronizer &msgsync, double realTimeFactor, const std::function<bool()> &onMessage) const
+{
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for(const Msg &msg : _msgs)
+    {
+        if(realTimeFactor > 0)
+            std::this_thread::sleep_until(start + std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+                std::chrono::duration<double>(msg.arrivalSec / realTimeFactor)));
+
+        if(msg.image)
+            msgsync.imageCallback(msg.image);
+        else
+            msgsync.imuCallback(msg.imu);
+
+        if(!onMessage())
+            return;
+    }
+}
+
+SyncChecker::SyncChecker(const SyntheticStream::Config &config, double syncDelaySec):
+    // rounded like the synchronizer does
+    _imageDelayNs((int64_t)(syncDelaySec * 1e9)), _streamDelaySec(config.imageDelaySec),
+    _lastImageStampNs(-1), _lastBackStampNs(-1),
+    _bundleCnt(0), _imuCnt(0), _errorCnt(0), _resetCnt(0), _maxInterpolationError(0)
+{
+}
+
+void SyncChecker::fail(const char* what, double stampSec)
+{
+    if(_errorCnt < 10)
+        printf("sync check: %s, image %.9f\n", what, stampSec);
+    _errorCnt++;
+}
+
+bool SyncChecker::check(const sensor_msgs::ImageConstPtr &image, const ImuMsgSpan &span)
+{
+    const size_t errorCnt = _errorCnt;
+    const double stampSec = image->header.stamp.toSec();
+    const int64_t imageStampNs = (int64_t)image->header.stamp.toNSec() - _imageDelayNs;
+    _bundleCnt++;
+    _imuCnt += span.size();
+
+    if(imageStampNs <= _lastImageStampNs)
+        fail("image stamps not increasing", stampSec);
+    if(span.back.stampNs != imageStampNs)
+        fail("back sample not at the image", stampSec);
+    // the synchronizer starts over after a gap of more than 3 seconds
+    if(!span.hasFront && _lastBackStampNs >= 0)
+        _resetCnt++;
+    if(span.hasFront && _lastBackStampNs < 0)
+        fail("front sample without a previous image", stampSec);
+    if(span.hasFront && span.front.stampNs != _lastBackStampNs)
+        fail("front sample not at the previous image", stampSec);
+
+    int64_t previousNs = span.hasFront ? span.front.stampNs : std::numeric_limits<int64_t>::min();
+    for(size_t i = 0; i < span.size(); i++)
+    {
+        const int64_t stampNs = (int64_t)span[i]->header.stamp.toNSec();
+        if(stampNs != span.stampsNs[i])
+            fail("stamp index out of sync with the messages", stampSec);
+        if(stampNs <= previousNs)
+            fail("imu messages not strictly increasing or repeated", stampSec);
+        if(stampNs >= imageStampNs)
+            fail("imu message past the image", stampSec);
+        previousNs = stampNs;
+    }
+
+    // how well the interpolated end follows the true signal at the exposure
+    Eigen::Vector3d gyro, acc;
+    SyntheticStream::getImuSignal(stampSec - _streamDelaySec, gyro, acc);
+    const Eigen::Vector3d interpolated(span.back.angular_velocity.x, span.back.angular_velocity.y, span.back.angular_velocity.z);
+    _maxInterpolationError = std::max(_maxInterpolationError, (interpolated - gyro).norm());
+
+    _lastImageStampNs = imageStampNs;
+    _lastBackStampNs = span.back.stampNs;
+    return _errorCnt == errorCnt;
+}
+
+}
@@ -0,0 +1,134 @@
+#ifndef SYNTHETICSTREAM_H
+#define SYNTHETICSTREAM_H
+
+#include <string>
+#include <vector>
+#include <functional>
+#include <cstdint>
+
+#include <Eigen/Core>
+
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/Imu.h>
+
+#include "MsgSync/MsgSynchronizer.h"
+
+namespace dso_vi
+{
+// Camera and imu message streams generated in memory, so MsgSynchronizer and the ingest
+// stage can be benchmarked and checked on any machine without a bag. The imu samples a
+// known smooth signal (getImuSignal) at imuRate. Images are stamped at the exposure time plus
+// imageDelaySec, in imu time (Camera.delaytoimu). Every message arrives after a transport
+// latency plus jitter. Messages can be dropped, reordered or left out in gaps.
+// Everything is generated up front from the seed, so runs are repeatable.
+class SyntheticStream
+{
+public:
+    // sensor outage, seconds from the start
+    struct Gap
+    {
+        double startSec;
+        double durationSec;
+    };
+
+    struct Config
+    {
+        Config();
+
+        double durationSec;
+        double imuRate;             // Hz
+        double cameraRate;          // Hz
+        double startSec;            // stamp of the first imu message
+        double imageDelaySec;       // image stamp - imu time of the exposure
+        double imuLatencySec;       // arrival - stamp
+        double imageLatencySec;
+        double arrivalJitterSec;    // uniform in [0, jitter) on top of the latency
+        double imuDropRate;         // fraction of the messages never sent
+        double imageDropRate;
+        double imuReorderRate;      // fraction of imu messages arriving after their successor
+        std::vector<Gap> imuGaps;
+        std::vector<Gap> imageGaps;
+        int imageWidth;             // mono8, 0 for images without pixels (synchronizer only)
+        int imageHeight;
+        unsigned seed;
+    };
+
+    // one of image and imu is set
+    struct Msg
+    {
+        double arrivalSec;          // from the start
+        sensor_msgs::ImageConstPtr image;
+        sensor_msgs::ImuConstPtr imu;
+    };
+
+    explicit SyntheticStream(const Config &config);
+
+    const Config &getConfig(void) const {return _config;}
+    // in arrival order
+    const std::vector<Msg> &getMsgs(void) const {return _msgs;}
+
+    size_t getImuCnt(void) const {return _imuCnt;}
+    size_t getImageCnt(void) const {return _imageCnt;}
+    size_t getImuDroppedCnt(void) const {return _imuDroppedCnt;}
+    size_t getImageDroppedCnt(void) const {return _imageDroppedCnt;}
+    size_t getImuReorderedCnt(void) const {return _imuReorderedCnt;}
+
+    // the signal the imu messages sample, t in seconds of imu time
+    static void getImuSignal(double t, Eigen::Vector3d &gyro, Eigen::Vector3d &acc);
+
+    // feed the messages to the synchronizer's callbacks in arrival order, onMessage after each.
+    // realTimeFactor > 0 paces them by arrival time (1: real time), 0 plays as fast as possible.
+    // Stops early when onMessage returns false
+    void play(MsgSynchronizer &msgsync, double realTimeFactor, const std::function<bool()> &onMessage) const;
+
+private:
+    static bool inGap(const std::vector<Gap> &gaps, double sec);
+
+    Config _config;
+    std::vector<Msg> _msgs;
+
+    size_t _imuCnt;
+    size_t _imageCnt;
+    size_t _imuDroppedCnt;
+    size_t _imageDroppedCnt;
+    size_t _imuReorderedCnt;
+};
+
+// Checks the bundles MsgSynchronizer hands out for a SyntheticStream: image stamps increase,
+// every imu message lies strictly inside its image interval (so none is delivered twice),
+// the interpolated ends sit exactly on the interval bounds and chain from one bundle to the next.
+// Also measures how far the interpolated back sample is off the true signal at the exposure,
+// which shows a synchronizer delay that doesn't match the stream's.
+class SyncChecker
+{
+public:
+    SyncChecker(const SyntheticStream::Config &config, double syncDelaySec);
+
+    // false (and a message printed for the first few) if the bundle breaks an invariant
+    bool check(const sensor_msgs::ImageConstPtr &image, const ImuMsgSpan &span);
+
+    size_t getBundleCnt(void) const {return _bundleCnt;}
+    size_t getImuCnt(void) const {return _imuCnt;}
+    size_t getErrorCnt(void) const {return _errorCnt;}
+    // bundles without a front sample after the first, the synchronizer cleared its buffers
+    size_t getResetCnt(void) const {return _resetCnt;}
+    // largest error of an interpolated gyro sample against the true signal, rad/s
+    double getMaxInterpolationError(void) const {return _maxInterpolationError;}
+
+private:
+    void fail(const char* what, double stampSec);
+
+    const int64_t _imageDelayNs;    // of the synchronizer
+    const double _streamDelaySec;
+    int64_t _lastImageStampNs;
+    int64_t _lastBackStampNs;
+    size_t _bundleCnt;
+    size_t _imuCnt;
+    size_t _errorCnt;
+    size_t _resetCnt;
+    double _maxInterpolationError;
+};
+
+}
+
+#endif // SYNTHETICSTREAM_H
@@ -0,0 +1,90 @@
+#include "Evaluator.h"
+
+#include <chrono>
+#include <limits>
+
+#include "Log/LogEigen.h"
+
+namespace dso_vi
+{
+
+Evaluator::Evaluator(const GroundTruthCache &groundTruth, const Eigen::Matrix3d &Rbc,
+                     LogWriter &log, size_t queueSize):
+    _groundTruth(groundTruth), _Rbc(Rbc), _Rcb(_Rbc.inverse()),
+    _log(log),
+    _queue(queueSize), _drainBuf(_queue.capacity()),
+    _stop(false), _evaluatedCnt(0)
+{
+    _thread = std::thread(&Evaluator::run, this);
+}
+
+Evaluator::~Evaluator()
+{
+    shutdown();
+}
+
+bool Evaluator::push(const Record &record)
+{
+    if(!_queue.push(record))
+        return false;
+    // no lock on the tracking thread, a missed notification is caught by the wait timeout
+    _wakeCond.notify_one();
+    return true;
+}
+
+void Evaluator::shutdown(void)
+{
+    _stop = true;
+    _wakeCond.notify_one();
+    if(_thread.joinable())
+        _thread.join();
+}
+
+void Evaluator::run(void)
+{
+    while(true)
+    {
+        // read the flag first, so the records pushed before the stop are drained below
+        const bool stop = _stop;
+        const size_t n = _queue.drain(_drainBuf.begin());
+        for(size_t i = 0; i < n; i++)
+            evaluate(_drainBuf[i]);
+        _evaluatedCnt += n;
+
+        if(stop && n == 0)
+            return;
+        if(n == 0)
+        {
+            std::unique_lock<std::mutex> lock(_wakeMutex);
+            _wakeCond.wait_for(lock, std::chrono::milliseconds(50));
+        }
+    }
+}
+
+void Evaluator::evaluate(const Record &record)
+{
+    // nan in a gap of the ground truth
+    gtsam::Pose3 relativePose;
+    GroundTruthCache::Measurement previousState, currentState;
+    const bool hasGroundTruth = _groundTruth.getRelativePose(record.previousTimestamp, record.timestamp,
+                                                             relativePose, previousState, currentState);
+
+    // predicted by DSO
+    const Eigen::Quaternion<double> quaternionDSO = record.dsoDeltaR.toQuaternion();
+    // predicted by IMU
+    const Eigen::Quaternion<double> quaternionIMU = _Rcb.compose(record.imuDeltaR).compose(_Rbc).toQuaternion();
+    // from groundtruth
+    Eigen::Quaternion<double> quaternionGT = _Rcb.compose(relativePose.rotation()).compose(_Rbc).toQuaternion();
+    if(!hasGroundTruth)
+        quaternionGT.coeffs().setConstant(std::numeric_limits<double>::quiet_NaN());
+
+    LogRotationComparison comparison;
+    comparison.previousTimestamp = record.previousTimestamp;
+    comparison.timestamp = record.timestamp;
+    toLog(quaternionDSO, comparison.dso);
+    toLog(quaternionIMU, comparison.imu);
+    toLog(quaternionGT, comparison.gt);
+    _log.write(comparison);
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef EVALUATOR_H
+#define EVALUATOR_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include <Eigen/Core>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "MsgSync/SPSCRingBuffer.h"
+#include "GroundTruthCache.h"
+#include "Log/LogWriter.h"
+
+namespace dso_vi
+{
+// Compares the tracked frames with the ground truth on its own thread.
+// The tracking thread only pushes a record per frame into a ring buffer, the
+// ground truth lookups and comparisons happen here, the results go to the run log.
+// Only created when there is a ground truth file.
+class Evaluator
+{
+public:
+    struct Record
+    {
+        double previousTimestamp;   // image time of the previous tracked frame
+        double timestamp;
+        gtsam::Rot3 dsoDeltaR;      // DSO rotation since the previous frame, camera frame
+        gtsam::Rot3 imuDeltaR;      // preintegrated rotation since the previous frame, body frame
+    };
+
+    // Rbc: camera to body rotation. log gets the relative rotations of DSO, the imu
+    // and the ground truth per frame, in the camera frame (LogRotationComparison)
+    Evaluator(const GroundTruthCache &groundTruth, const Eigen::Matrix3d &Rbc,
+              LogWriter &log, size_t queueSize = 1024);
+    ~Evaluator();
+
+    // tracking thread, never blocks. false if the evaluator fell behind and the record was dropped
+    bool push(const Record &record);
+
+    // evaluate what's queued and stop
+    void shutdown(void);
+
+    uint64_t getEvaluatedCnt(void) const {return _evaluatedCnt;}
+    uint64_t getDroppedCnt(void) const {return _queue.getOverflowCnt();}
+
+private:
+    void run(void);
+    void evaluate(const Record &record);
+
+    const GroundTruthCache &_groundTruth;
+    const gtsam::Rot3 _Rbc;
+    const gtsam::Rot3 _Rcb;
+    LogWriter &_log;
+
+    SPSCRingBuffer<Record> _queue;
+    std::vector<Record> _drainBuf;
+
+    std::mutex _wakeMutex;
+    std::condition_variable _wakeCond;
+    std::atomic<bool> _stop;
+    std::atomic<uint64_t> _evaluatedCnt;
+
+    std::thread _thread;
+};
+
+}
+
+#endif // EVALUATOR_H
@@ -0,0 +1,217 @@
+#include "GroundTruthCache.h"
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <Eigen/Geometry>
+
+namespace dso_vi
+{
+
+namespace
+{
+const char cacheMagic[8] = {'D', 'S', 'O', 'G', 'T', 'v', '1', 0};
+
+struct CacheHeader
+{
+    char magic[8];
+    uint64_t recordSize;
+    uint64_t count;
+    int64_t csvSize;
+    int64_t csvMtime;
+};
+
+bool recordBefore(const GroundTruthCache::Record &record, int64_t stampNs)
+{
+    return record.stampNs < stampNs;
+}
+}
+
+GroundTruthCache::GroundTruthCache(const std::string &csvFile, double maxGapSec):
+    _maxGapSec(maxGapSec), _map(0), _mapSize(0), _data(0), _count(0), _gapCnt(0)
+{
+    struct stat csvStat;
+    if(stat(csvFile.c_str(), &csvStat) != 0)
+    {
+        printf("ground truth %s not found\n", csvFile.c_str());
+        return;
+    }
+
+    const std::string binFile = csvFile + ".bin";
+    if(loadCache(binFile, csvStat.st_size, csvStat.st_mtime))
+    {
+        printf("ground truth: %lu states mapped from %s\n", (unsigned long)_count, binFile.c_str());
+        return;
+    }
+
+    if(!parseCsv(csvFile))
+        return;
+    printf("ground truth: %lu states parsed from %s\n", (unsigned long)_count, csvFile.c_str());
+    writeCache(binFile, csvStat.st_size, csvStat.st_mtime);
+}
+
+GroundTruthCache::~GroundTruthCache()
+{
+    if(_map)
+        munmap(_map, _mapSize);
+}
+
+bool GroundTruthCache::loadCache(const std::string &binFile, int64_t csvSize, int64_t csvMtime)
+{
+    const int fd = open(binFile.c_str(), O_RDONLY);
+    if(fd < 0)
+        return false;
+
+    struct stat binStat;
+    if(fstat(fd, &binStat) != 0 || (size_t)binStat.st_size < sizeof(CacheHeader))
+    {
+        close(fd);
+        return false;
+    }
+
+    void* map = mmap(0, binStat.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if(map == MAP_FAILED)
+        return false;
+
+    const CacheHeader* header = (const CacheHeader*)map;
+    const bool valid = memcmp(header->magic, cacheMagic, sizeof(cacheMagic)) == 0 &&
+            header->recordSize == sizeof(Record) &&
+            header->csvSize == csvSize && header->csvMtime == csvMtime &&
+            (size_t)binStat.st_size == sizeof(CacheHeader) + header->count * sizeof(Record);
+    if(!valid || header->count == 0)
+    {
+        munmap(map, binStat.st_size);
+        return false;
+    }
+
+    _map = map;
+    _mapSize = binStat.st_size;
+    _data = (const Record*)((const char*)map + sizeof(CacheHeader));
+    _count = header->count;
+    return true;
+}
+
+bool GroundTruthCache::parseCsv(const std::string &csvFile)
+{
+    std::ifstream file(csvFile.c_str());
+    if(!file.is_open())
+    {
+        printf("could not open ground truth %s\n", csvFile.c_str());
+        return false;
+    }
+
+    // #timestamp, p_RS_R_x [m], ..., q_RS_w [], ..., v_RS_R_x [m s^-1], ..., b_w_RS_S_x [rad s^-1], ..., b_a_RS_S_x [m s^-2], ...
+    std::string line;
+    while(std::getline(file, line))
+    {
+        if(line.empty() || line[0] == '#')
+            continue;
+        std::replace(line.begin(), line.end(), ',', ' ');
+
+        Record record;
+        std::istringstream in(line);
+        long long stampNs;
+        in >> stampNs
+           >> record.p[0] >> record.p[1] >> record.p[2]
+           >> record.q[0] >> record.q[1] >> record.q[2] >> record.q[3]
+           >> record.v[0] >> record.v[1] >> record.v[2]
+           >> record.bg[0] >> record.bg[1] >> record.bg[2]
+           >> record.ba[0] >> record.ba[1] >> record.ba[2];
+        if(in.fail())
+        {
+            printf("skipping malformed ground truth line \"%s\"\n", line.c_str());
+            continue;
+        }
+        record.stampNs = stampNs;
+        _records.push_back(record);
+    }
+
+    std::stable_sort(_records.begin(), _records.end(),
+                     [](const Record &a, const Record &b) {return a.stampNs < b.stampNs;});
+    _data = _records.data();
+    _count = _records.size();
+    return _count > 0;
+}
+
+void GroundTruthCache::writeCache(const std::string &binFile, int64_t csvSize, int64_t csvMtime) const
+{
+    // best effort, the dataset directory may be read-only. Written under a temporary
+    // name and renamed, so a concurrent start never maps half a file
+    const std::string tmpFile = binFile + ".tmp";
+    FILE* file = fopen(tmpFile.c_str(), "wb");
+    if(!file)
+        return;
+
+    CacheHeader header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, cacheMagic, sizeof(cacheMagic));
+    header.recordSize = sizeof(Record);
+    header.count = _count;
+    header.csvSize = csvSize;
+    header.csvMtime = csvMtime;
+
+    const bool ok = fwrite(&header, sizeof(header), 1, file) == 1 &&
+            fwrite(_data, sizeof(Record), _count, file) == _count;
+    if(fclose(file) == 0 && ok)
+        rename(tmpFile.c_str(), binFile.c_str());
+    else
+        remove(tmpFile.c_str());
+}
+
+bool GroundTruthCache::getMeasurement(double t, Measurement &measurement) const
+{
+    const int64_t stampNs = (int64_t)(t * 1e9 + (t >= 0 ? 0.5 : -0.5));
+    const Record* end = _data + _count;
+    const Record* after = std::lower_bound(_data, end, stampNs, recordBefore);
+
+    // outside the recording, or between two samples too far apart
+    if(after == end || (after->stampNs != stampNs &&
+                        (after == _data || (after->stampNs - (after - 1)->stampNs) * 1e-9 > _maxGapSec)))
+    {
+        _gapCnt.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    const Record &b = *after;
+    const Record &a = after->stampNs == stampNs ? b : *(after - 1);
+    const double s = b.stampNs > a.stampNs ? (double)(stampNs - a.stampNs) / (double)(b.stampNs - a.stampNs) : 0.;
+
+    const Eigen::Quaterniond qa(a.q[0], a.q[1], a.q[2], a.q[3]);
+    const Eigen::Quaterniond qb(b.q[0], b.q[1], b.q[2], b.q[3]);
+    const Eigen::Quaterniond q = qa.normalized().slerp(s, qb.normalized());
+
+    Eigen::Vector3d p, v, bg, ba;
+    for(int i = 0; i < 3; i++)
+    {
+        p(i) = a.p[i] + s * (b.p[i] - a.p[i]);
+        v(i) = a.v[i] + s * (b.v[i] - a.v[i]);
+        bg(i) = a.bg[i] + s * (b.bg[i] - a.bg[i]);
+        ba(i) = a.ba[i] + s * (b.ba[i] - a.ba[i]);
+    }
+
+    measurement.timestamp = stampNs * 1e-9;
+    measurement.pose = gtsam::Pose3(gtsam::Rot3(q), gtsam::Point3(p));
+    measurement.velocity = v;
+    measurement.bias = gtsam::imuBias::ConstantBias(ba, bg);
+    return true;
+}
+
+bool GroundTruthCache::getRelativePose(double t0, double t1, gtsam::Pose3 &relativePose,
+                                       Measurement &state0, Measurement &state1) const
+{
+    if(!getMeasurement(t0, state0) || !getMeasurement(t1, state1))
+        return false;
+    relativePose = state0.pose.between(state1.pose);
+    return true;
+}
+
+}
@@ -0,0 +1,75 @@
+#ifndef GROUNDTRUTHCACHE_H
+#define GROUNDTRUTHCACHE_H
+
+#include <string>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "GroundTruthIterator/GroundTruthIterator.h"
+
+namespace dso_vi
+{
+// EuRoC ground truth (state_groundtruth_estimate0/data.csv) loaded once at startup into a
+// time sorted array, queried by binary search and interpolation.
+// The parsed array is cached as <csv>.bin next to the csv and memory mapped on the
+// next start, as long as the csv's size and modification time still match.
+// Times without ground truth (before/after the recording, or samples further apart than
+// maxGapSec) are gaps: queries return false instead of throwing.
+// Read only after construction, queries are thread safe.
+class GroundTruthCache
+{
+public:
+    typedef GroundTruthIterator::ground_truth_measurement_t Measurement;
+
+    // one csv row, stored as is in the cache file
+    struct Record
+    {
+        int64_t stampNs;
+        double p[3];        // position in world
+        double q[4];        // w, x, y, z body to world
+        double v[3];        // velocity in world
+        double bg[3];       // gyro bias
+        double ba[3];       // accelerometer bias
+    };
+
+    explicit GroundTruthCache(const std::string &csvFile, double maxGapSec = 0.05);
+    ~GroundTruthCache();
+
+    // false if the csv couldn't be read
+    bool isValid(void) const {return _count > 0;}
+    size_t size(void) const {return _count;}
+
+    // state interpolated at t (seconds), false in a gap
+    bool getMeasurement(double t, Measurement &measurement) const;
+    // pose of t1 relative to t0 and the states at both ends, false if either is in a gap
+    bool getRelativePose(double t0, double t1, gtsam::Pose3 &relativePose,
+                         Measurement &state0, Measurement &state1) const;
+
+    uint64_t getGapCnt(void) const {return _gapCnt.load(std::memory_order_relaxed);}
+
+private:
+    GroundTruthCache(const GroundTruthCache&);
+    GroundTruthCache& operator=(const GroundTruthCache&);
+
+    bool loadCache(const std::string &binFile, int64_t csvSize, int64_t csvMtime);
+    bool parseCsv(const std::string &csvFile);
+    void writeCache(const std::string &binFile, int64_t csvSize, int64_t csvMtime) const;
+
+    const double _maxGapSec;
+
+    // either _records (parsed) or the mapped cache file
+    std::vector<Record> _records;
+    void* _map;
+    size_t _mapSize;
+    const Record* _data;
+    size_t _count;
+
+    mutable std::atomic<uint64_t> _gapCnt;   // queried from more than one thread
+};
+
+}
+
+#endif // GROUNDTRUTHCACHE_H
@@ -0,0 +1,245 @@
+#include "TrajectoryMetrics.h"
+#include "GroundTruthCache.h"
+#include "Log/LogReader.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dso_vi
+{
+
+namespace
+{
+const double radToDeg = 180.0 / M_PI;
+
+Eigen::Quaterniond fromLog(const double q[4])
+{
+    return Eigen::Quaterniond(q[0], q[1], q[2], q[3]);
+}
+
+// translation (m) and rotation (deg) of the error between two relative poses
+void relativeError(const gtsam::Pose3 &groundTruth, const gtsam::Pose3 &estimate,
+                   double &translation, double &rotation)
+{
+    const gtsam::Pose3 error = groundTruth.between(estimate);
+    translation = error.translation().norm();
+    rotation = gtsam::Rot3::Logmap(error.rotation()).norm() * radToDeg;
+}
+
+void writeStatsJson(FILE* out, const char* name, const ErrorStats &stats)
+{
+    fprintf(out, "\"%s\": {\"count\": %lu, \"mean\": %.6g, \"rmse\": %.6g, \"median\": %.6g, \"max\": %.6g}",
+            name, (unsigned long)stats.count, stats.mean, stats.rmse, stats.median, stats.max);
+}
+
+void printStats(FILE* out, const char* name, const ErrorStats &stats)
+{
+    fprintf(out, "%-24s n %6lu  mean %9.4f  rmse %9.4f  median %9.4f  max %9.4f\n",
+            name, (unsigned long)stats.count, stats.mean, stats.rmse, stats.median, stats.max);
+}
+}
+
+ErrorStats computeErrorStats(std::vector<double> &errors)
+{
+    ErrorStats stats;
+    std::vector<double>::iterator end = std::remove_if(errors.begin(), errors.end(),
+                                                       [](double e) {return std::isnan(e);});
+    stats.count = end - errors.begin();
+    if(stats.count == 0)
+        return stats;
+
+    std::sort(errors.begin(), end);
+    double sum = 0, sumSq = 0;
+    for(std::vector<double>::iterator e = errors.begin(); e != end; ++e)
+    {
+        sum += *e;
+        sumSq += *e * *e;
+    }
+    stats.mean = sum / stats.count;
+    stats.rmse = std::sqrt(sumSq / stats.count);
+    stats.median = errors[stats.count / 2];
+    stats.max = errors[stats.count - 1];
+    return stats;
+}
+
+TrajectoryMetrics::TrajectoryMetrics()
+{
+}
+
+void TrajectoryMetrics::addPose(double timestamp, const gtsam::Pose3 &estimate, const gtsam::Pose3 &groundTruth)
+{
+    _timestamps.push_back(timestamp);
+    _estimates.push_back(estimate);
+    _groundTruth.push_back(groundTruth);
+}
+
+void TrajectoryMetrics::addRotationComparison(const Eigen::Quaterniond &dso, const Eigen::Quaterniond &imu,
+                                              const Eigen::Quaterniond &gt)
+{
+    // nan propagates from a gap, the stats skip it
+    _dsoVsGt.push_back(dso.angularDistance(gt) * radToDeg);
+    _imuVsGt.push_back(imu.angularDistance(gt) * radToDeg);
+    _dsoVsImu.push_back(dso.angularDistance(imu) * radToDeg);
+}
+
+size_t TrajectoryMetrics::addLog(LogReader &reader, const GroundTruthCache &groundTruth, const gtsam::Pose3 &bodyToCamera)
+{
+    size_t gapCnt = 0;
+    while(reader.next())
+    {
+        LogFramePose pose;
+        LogRotationComparison comparison;
+        if(reader.get(pose))
+        {
+            GroundTruthCache::Measurement state;
+            if(!groundTruth.getMeasurement(pose.timestamp, state))
+            {
+                gapCnt++;
+                continue;
+            }
+            addPose(
+                pose.timestamp,
+                gtsam::Pose3(gtsam::Rot3(fromLog(pose.q)), gtsam::Point3(pose.t[0], pose.t[1], pose.t[2])),
+                state.pose.compose(bodyToCamera)
+            );
+        }
+        else if(reader.get(comparison))
+        {
+            addRotationComparison(fromLog(comparison.dso), fromLog(comparison.imu), fromLog(comparison.gt));
+        }
+    }
+    return gapCnt;
+}
+
+bool TrajectoryMetrics::compute(Summary &summary, double rpeDeltaSec, const std::vector<double> &driftLengths) const
+{
+    const size_t n = _estimates.size();
+    summary.poseCnt = n;
+    summary.comparisonCnt = _dsoVsGt.size();
+    summary.pathLength = 0;
+    summary.scale = 1;
+    summary.drift.clear();
+
+    std::vector<double> dsoVsGt = _dsoVsGt, imuVsGt = _imuVsGt, dsoVsImu = _dsoVsImu;
+    summary.dsoVsGt = computeErrorStats(dsoVsGt);
+    summary.imuVsGt = computeErrorStats(imuVsGt);
+    summary.dsoVsImu = computeErrorStats(dsoVsImu);
+
+    if(n < 3)
+        return false;
+
+    // gt ~ scale * R * estimate + t over the camera positions
+    Eigen::Matrix3Xd estimatePositions(3, n), groundTruthPositions(3, n);
+    for(size_t i = 0; i < n; i++)
+    {
+        estimatePositions.col(i) = _estimates[i].translation();
+        groundTruthPositions.col(i) = _groundTruth[i].translation();
+    }
+    const Eigen::Matrix4d sim3 = Eigen::umeyama(estimatePositions, groundTruthPositions, true);
+    const double scale = sim3.block<3,1>(0,0).norm();
+    const Eigen::Matrix3d R = sim3.block<3,3>(0,0) / scale;
+    const Eigen::Vector3d t = sim3.block<3,1>(0,3);
+    summary.scale = scale;
+
+    std::vector<gtsam::Pose3> aligned;
+    aligned.reserve(n);
+    std::vector<double> ate(n), pathLength(n, 0.0);
+    for(size_t i = 0; i < n; i++)
+    {
+        aligned.push_back(gtsam::Pose3(
+            gtsam::Rot3(Eigen::Matrix3d(R * _estimates[i].rotation().matrix())),
+            gtsam::Point3(scale * R * _estimates[i].translation() + t)
+        ));
+        ate[i] = (aligned[i].translation() - _groundTruth[i].translation()).norm();
+        if(i > 0)
+            pathLength[i] = pathLength[i-1] + (_groundTruth[i].translation() - _groundTruth[i-1].translation()).norm();
+    }
+    summary.ate = computeErrorStats(ate);
+    summary.pathLength = pathLength[n-1];
+
+    // rpe between each pose and the first one at least rpeDeltaSec later,
+    // pairs across a tracking loss (more than twice the delta) are skipped
+    std::vector<double> rpeTranslation, rpeRotation;
+    for(size_t i = 0; i < n; i++)
+    {
+        const size_t j = std::lower_bound(_timestamps.begin() + i, _timestamps.end(), _timestamps[i] + rpeDeltaSec) - _timestamps.begin();
+        if(j == n)
+            break;
+        if(_timestamps[j] - _timestamps[i] > 2 * rpeDeltaSec)
+            continue;
+
+        double translation, rotation;
+        relativeError(_groundTruth[i].between(_groundTruth[j]), aligned[i].between(aligned[j]), translation, rotation);
+        rpeTranslation.push_back(translation);
+        rpeRotation.push_back(rotation);
+    }
+    summary.rpeTranslation = computeErrorStats(rpeTranslation);
+    summary.rpeRotation = computeErrorStats(rpeRotation);
+
+    // drift over segments of ground truth path
+    for(double length : driftLengths)
+    {
+        Drift drift = {length, 0, 0, 0};
+        for(size_t i = 0; i < n; i++)
+        {
+            const size_t j = std::lower_bound(pathLength.begin() + i, pathLength.end(), pathLength[i] + length) - pathLength.begin();
+            if(j == n)
+                break;
+
+            double translation, rotation;
+            relativeError(_groundTruth[i].between(_groundTruth[j]), aligned[i].between(aligned[j]), translation, rotation);
+            drift.translation += translation / length * 100.0;
+            drift.rotation += rotation / length;
+            drift.count++;
+        }
+        if(drift.count == 0)
+            continue;
+        drift.translation /= drift.count;
+        drift.rotation /= drift.count;
+        summary.drift.push_back(drift);
+    }
+    return true;
+}
+
+void TrajectoryMetrics::print(FILE* out, const Summary &summary)
+{
+    fprintf(out, "%lu poses, %.2fm of ground truth path, Sim(3) scale %.4f\n",
+            (unsigned long)summary.poseCnt, summary.pathLength, summary.scale);
+    printStats(out, "ate [m]", summary.ate);
+    printStats(out, "rpe translation [m]", summary.rpeTranslation);
+    printStats(out, "rpe rotation [deg]", summary.rpeRotation);
+    for(const Drift &drift : summary.drift)
+        fprintf(out, "drift over %5.1fm       n %6lu  translation %.3f%%  rotation %.4fdeg/m\n",
+                drift.length, (unsigned long)drift.count, drift.translation, drift.rotation);
+    fprintf(out, "%lu rotation comparisons, error of the relative rotation [deg]\n", (unsigned long)summary.comparisonCnt);
+    printStats(out, "  dso vs gt", summary.dsoVsGt);
+    printStats(out, "  imu vs gt", summary.imuVsGt);
+    printStats(out, "  dso vs imu", summary.dsoVsImu);
+}
+
+void TrajectoryMetrics::writeJson(FILE* out, const Summary &summary)
+{
+    fprintf(out, "{\"poses\": %lu, \"comparisons\": %lu, \"path_length_m\": %.6g, \"scale\": %.6g, ",
+            (unsigned long)summary.poseCnt, (unsigned long)summary.comparisonCnt, summary.pathLength, summary.scale);
+    writeStatsJson(out, "ate_m", summary.ate);
+    fprintf(out, ", ");
+    writeStatsJson(out, "rpe_translation_m", summary.rpeTranslation);
+    fprintf(out, ", ");
+    writeStatsJson(out, "rpe_rotation_deg", summary.rpeRotation);
+    fprintf(out, ", \"drift\": [");
+    for(size_t i = 0; i < summary.drift.size(); i++)
+    {
+        const Drift &drift = summary.drift[i];
+        fprintf(out, "%s{\"length_m\": %g, \"count\": %lu, \"translation_pct\": %.6g, \"rotation_deg_per_m\": %.6g}",
+                i > 0 ? ", " : "", drift.length, (unsigned long)drift.count, drift.translation, drift.rotation);
+    }
+    fprintf(out, "], \"rotation_error_deg\": {");
+    writeStatsJson(out, "dso_vs_gt", summary.dsoVsGt);
+    fprintf(out, ", ");
+    writeStatsJson(out, "imu_vs_gt", summary.imuVsGt);
+    fprintf(out, ", ");
+    writeStatsJson(out, "dso_vs_imu", summary.dsoVsImu);
+    fprintf(out, "}}");
+}
+
+}
@@ -0,0 +1,97 @@
+#ifndef TRAJECTORYMETRICS_H
+#define TRAJECTORYMETRICS_H
+
+#include <vector>
+#include <cstdio>
+
+#include <Eigen/Geometry>
+
+#include <gtsam/geometry/Pose3.h>
+
+namespace dso_vi
+{
+class GroundTruthCache;
+class LogReader;
+
+// mean, rmse, median and max of a set of errors
+struct ErrorStats
+{
+    ErrorStats(): count(0), mean(0), rmse(0), median(0), max(0) {}
+
+    size_t count;
+    double mean;
+    double rmse;
+    double median;
+    double max;
+};
+
+// reorders errors, nan entries are skipped
+ErrorStats computeErrorStats(std::vector<double> &errors);
+
+// Error metrics of a monocular run against the ground truth. Poses and rotation comparisons
+// are added as they are read from the log, the metrics are computed once at the end:
+// ATE after Umeyama Sim(3) alignment (DSO's scale is arbitrary), RPE over a fixed time delta,
+// drift over fixed lengths of ground truth path and the relative rotation errors of DSO
+// and the imu preintegration against the ground truth.
+class TrajectoryMetrics
+{
+public:
+    // drift over one path length
+    struct Drift
+    {
+        double length;          // m of ground truth path
+        size_t count;
+        double translation;     // mean translation error, % of the length
+        double rotation;        // mean rotation error, deg/m
+    };
+
+    struct Summary
+    {
+        size_t poseCnt;
+        size_t comparisonCnt;
+        double pathLength;      // m of ground truth path covered by the poses
+        double scale;           // of the Sim(3) alignment
+
+        ErrorStats ate;         // m
+        ErrorStats rpeTranslation;  // m per rpeDeltaSec
+        ErrorStats rpeRotation;     // deg per rpeDeltaSec
+        std::vector<Drift> drift;
+
+        // relative rotation between consecutive frames, deg
+        ErrorStats dsoVsGt;
+        ErrorStats imuVsGt;
+        ErrorStats dsoVsImu;
+    };
+
+    TrajectoryMetrics();
+
+    // camera to world of a tracked frame and of the ground truth at its timestamp, in time order
+    void addPose(double timestamp, const gtsam::Pose3 &estimate, const gtsam::Pose3 &groundTruth);
+    // relative rotations of a frame, gt may be nan (gap in the ground truth)
+    void addRotationComparison(const Eigen::Quaterniond &dso, const Eigen::Quaterniond &imu,
+                               const Eigen::Quaterniond &gt);
+    // poses and rotation comparisons of a run log, the ground truth camera pose is the body
+    // pose composed with bodyToCamera. Returns the number of poses without ground truth
+    size_t addLog(LogReader &reader, const GroundTruthCache &groundTruth, const gtsam::Pose3 &bodyToCamera);
+
+    // false if there are too few poses to align
+    bool compute(Summary &summary, double rpeDeltaSec = 1.0,
+                 const std::vector<double> &driftLengths = std::vector<double>{1.0, 5.0, 10.0, 20.0}) const;
+
+    static void print(FILE* out, const Summary &summary);
+    // a single json object
+    static void writeJson(FILE* out, const Summary &summary);
+
+private:
+    std::vector<double> _timestamps;
+    std::vector<gtsam::Pose3> _estimates;
+    std::vector<gtsam::Pose3> _groundTruth;
+
+    std::vector<double> _dsoVsGt;
+    std::vector<double> _imuVsGt;
+    std::vector<double> _dsoVsImu;
+};
+
+}
+
+#endif // TRAJECTORYMETRICS_H
@@ -0,0 +1,22 @@
+#ifndef LOGEIGEN_H
+#define LOGEIGEN_H
+
+#include <Eigen/Geometry>
+
+namespace dso_vi
+{
+// Eigen types to the plain arrays of the log records, kept out of LogFormat.h
+// so the log readers don't need Eigen
+
+// w, x, y, z like LogFormat.h
+inline void toLog(const Eigen::Quaternion<double> &quaternion, double q[4])
+{
+    q[0] = quaternion.w();
+    q[1] = quaternion.x();
+    q[2] = quaternion.y();
+    q[3] = quaternion.z();
+}
+
+}
+
+#endif // LOGEIGEN_H
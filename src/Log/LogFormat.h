@@ -0,0 +1,96 @@
+#ifndef LOGFORMAT_H
+#define LOGFORMAT_H
+
+#include <cstdint>
+
+namespace dso_vi
+{
+// Binary run log written by LogWriter: a LogFileHeader followed by records,
+// each a LogRecordHeader and a fixed size payload. Readers skip types they don't
+// know by the size in the header, so records can be added without breaking old logs.
+// Everything is host byte order, the logs are read on the machine that wrote them.
+// Quaternions are w, x, y, z.
+
+const char logMagic[8] = {'D', 'S', 'O', 'L', 'O', 'G', 'v', '1'};
+const uint32_t logVersion = 1;
+
+struct LogFileHeader
+{
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+};
+
+enum LogRecordType
+{
+    LOG_FRAME_POSE = 1,
+    LOG_IMU_DELTA = 2,
+    LOG_FRAME_TIMING = 3,
+    LOG_ROTATION_COMPARISON = 4,
+    LOG_FRAME_LATENCY = 5
+};
+
+struct LogRecordHeader
+{
+    uint32_t type;
+    uint32_t size;      // payload bytes
+};
+
+// camera to world of a tracked frame, DSO's scale
+struct LogFramePose
+{
+    static const uint32_t TYPE = LOG_FRAME_POSE;
+
+    double timestamp;
+    double t[3];
+    double q[4];
+};
+
+// preintegrated imu rotation between two frames, body frame, and the gyro bias it used
+struct LogImuDelta
+{
+    static const uint32_t TYPE = LOG_IMU_DELTA;
+
+    double previousTimestamp;
+    double timestamp;
+    double q[4];
+    double gyroBias[3];
+};
+
+// time the tracking stage spent on a frame
+struct LogFrameTiming
+{
+    static const uint32_t TYPE = LOG_FRAME_TIMING;
+
+    double timestamp;
+    double trackSec;
+    int32_t frameId;
+    int32_t tracked;
+};
+
+// image added to the synchronizer -> tracked, follows the LogFrameTiming of the frame.
+// Only written with latency=1
+struct LogFrameLatency
+{
+    static const uint32_t TYPE = LOG_FRAME_LATENCY;
+
+    double timestamp;
+    double latencySec;
+};
+
+// relative rotation between two frames from DSO, the imu and the ground truth, camera frame.
+// gt is nan in a gap of the ground truth
+struct LogRotationComparison
+{
+    static const uint32_t TYPE = LOG_ROTATION_COMPARISON;
+
+    double previousTimestamp;
+    double timestamp;
+    double dso[4];
+    double imu[4];
+    double gt[4];
+};
+
+}
+
+#endif // LOGFORMAT_H
@@ -0,0 +1,51 @@
+#include "LogReader.h"
+
+namespace dso_vi
+{
+
+LogReader::LogReader(const std::string &file):
+    _file(0), _type(0)
+{
+    _file = fopen(file.c_str(), "rb");
+    if(!_file)
+    {
+        printf("could not open log %s\n", file.c_str());
+        return;
+    }
+    // records are small, the stdio buffer does the batching. Set before the first read
+    setvbuf(_file, 0, _IOFBF, 1 << 20);
+
+    LogFileHeader header;
+    if(fread(&header, sizeof(header), 1, _file) != 1
+       || memcmp(header.magic, logMagic, sizeof(header.magic)) != 0
+       || header.version != logVersion)
+    {
+        printf("%s is not a dso log of version %u\n", file.c_str(), logVersion);
+        fclose(_file);
+        _file = 0;
+        return;
+    }
+}
+
+LogReader::~LogReader()
+{
+    if(_file)
+        fclose(_file);
+}
+
+bool LogReader::next(void)
+{
+    if(!_file)
+        return false;
+
+    LogRecordHeader header;
+    if(fread(&header, sizeof(header), 1, _file) != 1)
+        return false;
+    _payload.resize(header.size);
+    if(header.size > 0 && fread(&_payload[0], header.size, 1, _file) != 1)
+        return false;
+    _type = header.type;
+    return true;
+}
+
+}
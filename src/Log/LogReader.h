@@ -0,0 +1,51 @@
+#ifndef LOGREADER_H
+#define LOGREADER_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <cstring>
+
+#include "LogFormat.h"
+
+namespace dso_vi
+{
+// Streams the records of a binary run log (see LogFormat.h), one at a time.
+// A truncated record at the end (run killed mid write) ends the log.
+class LogReader
+{
+public:
+    explicit LogReader(const std::string &file);
+    ~LogReader();
+
+    // false if the file is missing or not a log of a known version
+    bool isValid(void) const {return _file != 0;}
+
+    // next record, false at the end of the log
+    bool next(void);
+
+    uint32_t getType(void) const {return _type;}
+
+    // payload of the current record, false if it isn't a T
+    template<typename T>
+    bool get(T &record) const
+    {
+        if(_type != T::TYPE || _payload.size() != sizeof(T))
+            return false;
+        memcpy(&record, &_payload[0], sizeof(T));
+        return true;
+    }
+
+private:
+    LogReader(const LogReader&);
+    LogReader& operator=(const LogReader&);
+
+    FILE* _file;
+    uint32_t _type;
+    std::vector<char> _payload;
+};
+
+}
+
+#endif // LOGREADER_H
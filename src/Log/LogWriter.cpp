@@ -0,0 +1,115 @@
+#include "LogWriter.h"
+
+#include <chrono>
+#include <cstring>
+
+namespace dso_vi
+{
+
+LogWriter::LogWriter(const std::string &file, size_t bufferSize, double flushIntervalSec):
+    _flushIntervalSec(flushIntervalSec), _file(0),
+    _front(bufferSize), _back(bufferSize), _frontSize(0), _stop(false),
+    _recordCnt(0), _droppedCnt(0), _bytesWritten(0)
+{
+    _file = fopen(file.c_str(), "wb");
+    if(!_file)
+    {
+        printf("could not create log %s\n", file.c_str());
+        return;
+    }
+
+    LogFileHeader header;
+    memcpy(header.magic, logMagic, sizeof(header.magic));
+    header.version = logVersion;
+    header.reserved = 0;
+    fwrite(&header, sizeof(header), 1, _file);
+    _bytesWritten = sizeof(header);
+
+    _thread = std::thread(&LogWriter::run, this);
+}
+
+LogWriter::~LogWriter()
+{
+    shutdown();
+}
+
+bool LogWriter::append(uint32_t type, const void* payload, uint32_t size)
+{
+    LogRecordHeader header;
+    header.type = type;
+    header.size = size;
+    const size_t recordSize = sizeof(header) + size;
+    const size_t half = _front.size() / 2;
+
+    bool wake;
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        if(_stop || !_file || _frontSize + recordSize > _front.size())
+        {
+            _droppedCnt++;
+            return false;
+        }
+        memcpy(&_front[_frontSize], &header, sizeof(header));
+        memcpy(&_front[_frontSize + sizeof(header)], payload, size);
+        // wake the writer once per buffer, not per record
+        wake = _frontSize < half && _frontSize + recordSize >= half;
+        _frontSize += recordSize;
+    }
+    _recordCnt++;
+
+    if(wake)
+        _wakeCond.notify_one();
+    return true;
+}
+
+void LogWriter::shutdown(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _wakeCond.notify_one();
+    if(_thread.joinable())
+        _thread.join();
+
+    if(_file)
+    {
+        fclose(_file);
+        _file = 0;
+    }
+}
+
+void LogWriter::run(void)
+{
+    const size_t half = _front.size() / 2;
+    const std::chrono::duration<double> flushInterval(_flushIntervalSec);
+
+    std::unique_lock<std::mutex> lock(_mutex);
+    while(true)
+    {
+        _wakeCond.wait_for(lock, flushInterval, [this, half]() {
+            return _stop || _frontSize >= half;
+        });
+
+        // everything written before the stop is in this buffer
+        const bool stop = _stop;
+        _front.swap(_back);
+        const size_t size = _frontSize;
+        _frontSize = 0;
+        lock.unlock();
+
+        if(size > 0)
+        {
+            // one write per buffer, flushed so a crash loses at most a flush interval
+            fwrite(&_back[0], 1, size, _file);
+            fflush(_file);
+            _bytesWritten += size;
+        }
+
+        if(stop)
+            return;
+        lock.lock();
+    }
+}
+
+}
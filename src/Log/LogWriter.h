@@ -0,0 +1,73 @@
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <string>
+#include <vector>
+#include <cstdio>
+#include <cstdint>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+#include "LogFormat.h"
+
+namespace dso_vi
+{
+// Binary run log (see LogFormat.h) written on a background thread.
+// write() copies the record into the front buffer under a short lock; the writer
+// thread swaps the front and back buffers and writes the back one to disk outside the lock,
+// when the front one is half full or flushIntervalSec passed. If the front buffer is full
+// because the disk can't keep up, records are dropped and counted instead of blocking
+// the caller. Any thread can write.
+class LogWriter
+{
+public:
+    explicit LogWriter(const std::string &file, size_t bufferSize = 1 << 20, double flushIntervalSec = 0.5);
+    ~LogWriter();
+
+    // false if the file couldn't be created
+    bool isValid(void) const {return _file != 0;}
+
+    template<typename T>
+    bool write(const T &record)
+    {
+        return append(T::TYPE, &record, sizeof(T));
+    }
+
+    // write what's buffered and close the file
+    void shutdown(void);
+
+    uint64_t getRecordCnt(void) const {return _recordCnt;}
+    uint64_t getDroppedCnt(void) const {return _droppedCnt;}
+    uint64_t getBytesWritten(void) const {return _bytesWritten;}
+
+private:
+    LogWriter(const LogWriter&);
+    LogWriter& operator=(const LogWriter&);
+
+    bool append(uint32_t type, const void* payload, uint32_t size);
+    void run(void);
+
+    const double _flushIntervalSec;
+    FILE* _file;
+
+    // _front and _frontSize are guarded by _mutex, _back belongs to the writer thread
+    std::vector<char> _front;
+    std::vector<char> _back;
+    size_t _frontSize;
+
+    std::mutex _mutex;
+    std::condition_variable _wakeCond;
+    bool _stop;
+
+    std::atomic<uint64_t> _recordCnt;
+    std::atomic<uint64_t> _droppedCnt;
+    std::atomic<uint64_t> _bytesWritten;
+
+    std::thread _thread;
+};
+
+}
+
+#endif // LOGWRITER_H
@@ -1,14 +1,30 @@
 #include "MsgSynchronizer.h"
 #include "IMU/configparam.h"
+#include "Util/LatencyHistogram.h"
+
+#include <algorithm>
+#include <chrono>
+#include <limits>
 
 namespace dso_vi
 {
 
-MsgSynchronizer::MsgSynchronizer(const double& imagedelay):
-    _imageMsgDelaySec(imagedelay), _status(NOTINIT),
-    _dataUnsyncCnt(0)
+MsgSynchronizer::MsgSynchronizer(const double& imagedelay, size_t imageBufferSize, size_t imuBufferSize):
+    _imageMsgDelaySec(imagedelay),
+    _imageRing(imageBufferSize), _imuRing(imuBufferSize),
+    _imageDrainBuf(_imageRing.capacity()), _imuDrainBuf(_imuRing.capacity()),
+    _imageMsgQueue(_imageRing.capacity()),
+    _imuHead(0), _lastImageStampNs(-1), _imuLateCnt(0),
+    _stampArrival(false), _lastImageArrivalNs(0),
+    _status(NOTINIT),
+    _dropPolicy(KEEP_ALL), _latencyBudgetSec(0), _processingTimeSec(0), _pipelineFrames(0), _droppedImageCnt(0),
+    _wakeSeq(0), _wakeSeqSeen(0), _shutdown(false),
+    _wakeImuStampNs(std::numeric_limits<int64_t>::max()),
+    _lastGetSucceeded(false)
 {
-    printf("image delay set as %.1fms\n",_imageMsgDelaySec*1000);
+    printf("image delay set as %.1fms\n",imagedelay*1000);
+    _imuStampsNs.reserve(_imuRing.capacity());
+    _imuMsgs.reserve(_imuRing.capacity());
 }
 
 MsgSynchronizer::~MsgSynchronizer()
@@ -17,16 +33,14 @@ MsgSynchronizer::~MsgSynchronizer()
 }
 
 
-//int MsgSynchronizer::getImageMsgSize(void)
-//{
-//    unique_lock<mutex> lock(_mutexImageQueue);
-//    return _imageMsgQueue.size();
-//}
-
-bool MsgSynchronizer::getRecentMsgs(sensor_msgs::ImageConstPtr &imgmsg, std::vector<sensor_msgs::ImuConstPtr> &vimumsgs)
+bool MsgSynchronizer::getRecentMsgs(sensor_msgs::ImageConstPtr &imgmsg, ImuMsgSpan &vimumsgs)
 {
-    //unique_lock<mutex> lock2(_mutexIMUQueue);
-    unique_lock<mutex> lock1(_mutexImageQueue);
+    // the span handed out last time is not used anymore
+    compactImuBuffer();
+    drainRings();
+
+    _lastGetSucceeded = false;
+    _wakeImuStampNs = std::numeric_limits<int64_t>::min();
 
     if(_status == NOTINIT || _status == INIT)
     {
@@ -36,124 +50,189 @@ bool MsgSynchronizer::getRecentMsgs(sensor_msgs::ImageConstPtr &imgmsg, std::vec
     if(_imageMsgQueue.empty())
     {
         //ROS_INFO("no image stored in queue currently.");
+        _wakeImuStampNs = std::numeric_limits<int64_t>::max();
         return false;
     }
-    if(_imuMsgQueue.empty())
+
+    // the imu head stays at the last delivered image, so the samples of
+    // dropped images end up in the next bundle
+    applyDropPolicy();
+    if(_imuHead == _imuStampsNs.size())
     {
         //ROS_WARN("no imu message stored, shouldn't");
         return false;
     }
 
-    {
+    const int64_t delayNs = (int64_t)(getImageDelaySec() * 1e9);
+    const int64_t toleranceNs = 3000000000LL;
 
-        sensor_msgs::ImageConstPtr imsg;
-        sensor_msgs::ImuConstPtr bmsg;
+    // Check dis-continuity, tolerance 3 seconds
+    if((int64_t)_imageMsgQueue.back().msg->header.stamp.toNSec() - delayNs + toleranceNs < _imuStampsNs[_imuHead])
+    {
+        ROS_ERROR("Data dis-continuity, > 3 seconds. Buffer cleared");
+        clearMsgs();
+        return false;
+    }
 
-        //
-        imsg = _imageMsgQueue.back();
-        bmsg = _imuMsgQueue.front();
+    // a larger delay set since the last image must not move the interval backwards
+    const int64_t imageStampNs = std::max((int64_t)_imageMsgQueue.front().msg->header.stamp.toNSec() - delayNs, _lastImageStampNs);
+    if(imageStampNs > _imuStampsNs.back() + toleranceNs)
+    {
+        ROS_ERROR("Data dis-continuity, > 3 seconds. Buffer cleared");
+        clearMsgs();
+        return false;
+    }
 
-        // Check dis-continuity, tolerance 3 seconds
-        if(imsg->header.stamp.toSec()-_imageMsgDelaySec + 3.0 < bmsg->header.stamp.toSec() )
-        {
-            ROS_ERROR("Data dis-continuity, > 3 seconds. Buffer cleared");
-            clearMsgs();
-            return false;
-        }
+    // Wait imu messages in case communication block,
+    // the interval is complete once there's a sample at or after the image
+    if(imageStampNs > _imuStampsNs.back())
+    {
+        _wakeImuStampNs = imageStampNs;
+        return false;
+    }
 
-        //
-        imsg = _imageMsgQueue.front();
-        bmsg = _imuMsgQueue.back();
+    // get image message
+    imgmsg = _imageMsgQueue.front().msg;
+    _lastImageArrivalNs = _imageMsgQueue.front().arrivalNs;
+    _imageMsgQueue.pop_front();
+
+    // messages in (t_prev - delay, t_img - delay), found by binary search
+    const int64_t *stamps = _imuStampsNs.data();
+    const int64_t *first = stamps + _imuHead;
+    const int64_t *last = stamps + _imuStampsNs.size();
+    const bool hasFront = _lastImageStampNs >= 0;
+    if(hasFront)
+        first = std::upper_bound(first, last, _lastImageStampNs);
+    last = std::lower_bound(first, last, imageStampNs);
+
+    const size_t begin = first - stamps;
+    const size_t end = last - stamps;
+    vimumsgs.msgs = _imuMsgs.data() + begin;
+    vimumsgs.stampsNs = first;
+    vimumsgs.count = end - begin;
+
+    // interpolate the back sample between the last message before the image
+    // (or the front sample) and the first one at/after it, which exists, see the wait above
+    ImuSample before, after;
+    getImuSample(end, after);
+    if(end > begin)
+        getImuSample(end - 1, before);
+    else if(hasFront)
+        before = _lastBoundarySample;
+    else
+        before = after;
+    interpolateImuSample(before, after, imageStampNs, vimumsgs.back);
+
+    vimumsgs.hasFront = hasFront;
+    if(hasFront)
+        vimumsgs.front = _lastBoundarySample;
+
+    _imuHead = end;
+    _lastImageStampNs = imageStampNs;
+    _lastBoundarySample = vimumsgs.back;
+    _lastGetSucceeded = true;
 
-        // Wait imu messages in case communication block
-        if(imsg->header.stamp.toSec()-_imageMsgDelaySec > bmsg->header.stamp.toSec())
-        {
-            return false;
-        }
+    // the camera fps 20Hz, imu message 100Hz. so there should be not more than 5 imu messages between images
+    if(vimumsgs.size()>10)
+        ROS_WARN_THROTTLE(1.0, "%lu imu messages between images, note",vimumsgs.size());
 
-        // Check dis-continuity, tolerance 3 seconds
-        if(imsg->header.stamp.toSec()-_imageMsgDelaySec > bmsg->header.stamp.toSec() + 3.0)
-        {
-            ROS_ERROR("Data dis-continuity, > 3 seconds. Buffer cleared");
-            clearMsgs();
-            return false;
-        }
+    return true;
+}
 
-        // Wait until the imu packages totolly com
-        if(_imageMsgQueue.size()<10 && _imuMsgQueue.size()<15
-           && imsg->header.stamp.toSec()-_imageMsgDelaySec>bmsg->header.stamp.toSec() )
-        {
-            //ROS_WARN_STREAM("here return, last imu time "<<);
-            return false;
+void MsgSynchronizer::addImuMsg(const sensor_msgs::ImuConstPtr &imumsg)
+{
+    if(!_imuRing.push(imumsg))
+    {
+        ROS_WARN_THROTTLE(1.0, "imu ring buffer full, %lu messages dropped", (unsigned long)_imuRing.getOverflowCnt());
+        return;
+    }
 
-        }
+    // pairs with the fence in waitForMsgs: either we see the consumer's threshold
+    // or the consumer sees this message in the ring
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if((int64_t)imumsg->header.stamp.toNSec() >= _wakeImuStampNs.load())
+        notifyConsumer();
+}
 
+void MsgSynchronizer::addImageMsg(const sensor_msgs::ImageConstPtr &imgmsg)
+{
+    QueuedImage image;
+    image.msg = imgmsg;
+    if(_stampArrival)
+        image.arrivalNs = latencyNowNs();
+    if(!_imageRing.push(image))
+    {
+        ROS_WARN_THROTTLE(1.0, "image ring buffer full, %lu messages dropped", (unsigned long)_imageRing.getOverflowCnt());
+        return;
     }
+    notifyConsumer();
+}
 
-    // get image message
+void MsgSynchronizer::notifyConsumer(void)
+{
     {
-        imgmsg = _imageMsgQueue.front();
-        _imageMsgQueue.pop();
+        lock_guard<mutex> lock(_wakeMutex);
+        _wakeSeq++;
     }
+    _wakeCond.notify_one();
+}
 
-    // clear imu message vector, and push all imu messages whose timestamp is earlier than image message
-    vimumsgs.clear();
-    while(true)
-    {
-        // if no more imu messages, stop loop
-        if(_imuMsgQueue.empty())
-            break;
-
-        //TODO: consider the logic here!!!
-        //TODO: consider the logic here!!!
-        //TODO: consider the logic here!!!
-        //TODO: consider the logic here!!!
-        //TODO: consider the logic here!!!
-        //TODO: consider the logic here!!!
-
-        // consider delay between image and imu serial
-        sensor_msgs::ImuConstPtr tmpimumsg = _imuMsgQueue.front();
-        if(tmpimumsg->header.stamp.toSec() < imgmsg->header.stamp.toSec() - _imageMsgDelaySec)
-        {
-            // add to imu message vector
-            vimumsgs.push_back(tmpimumsg);
-            {
-                unique_lock<mutex> lock(_mutexIMUQueue);
-                _imuMsgQueue.pop();
-            }
+bool MsgSynchronizer::waitForMsgs(double timeoutSec)
+{
+    // there may be more bundles ready
+    if(_lastGetSucceeded)
+        return true;
+
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    const bool imuPending = !_imuRing.empty() && _wakeImuStampNs.load() != std::numeric_limits<int64_t>::max();
+
+    unique_lock<mutex> lock(_wakeMutex);
+    const bool woken = _wakeCond.wait_for(lock, std::chrono::duration<double>(timeoutSec),
+                                          [this, imuPending]{return imuPending || _shutdown || _wakeSeq != _wakeSeqSeen;});
+    _wakeSeqSeen = _wakeSeq;
+    return woken && !_shutdown;
+}
 
-            _dataUnsyncCnt = 0;
-        }
-        else
-        {
-            if(_dataUnsyncCnt++>10)
-            {
-                _dataUnsyncCnt = 0;
-                //_imuMsgQueue = std::queue<sensor_msgs::ImuConstPtr>();
-                clearMsgs();
-                ROS_ERROR("data unsynced many times, reset sync");
-                return false;
-            }
-            // stop loop
-            break;
-        }
+void MsgSynchronizer::shutdown(void)
+{
+    {
+        lock_guard<mutex> lock(_wakeMutex);
+        _shutdown = true;
     }
+    _wakeCond.notify_all();
+}
 
-    // the camera fps 20Hz, imu message 100Hz. so there should be not more than 5 imu messages between images
-    if(vimumsgs.size()>10)
-        ROS_WARN("%lu imu messages between images, note",vimumsgs.size());
-    if(vimumsgs.size()==0)
-        ROS_ERROR("no imu message between images!");
+void MsgSynchronizer::drainRings(void)
+{
+    // the stream that starts the synchronization is drained first
+    size_t nimu, nimage;
+    if(_imageMsgDelaySec >= 0)
+    {
+        nimu = _imuRing.drain(_imuDrainBuf.begin());
+        nimage = _imageRing.drain(_imageDrainBuf.begin());
+    }
+    else
+    {
+        nimage = _imageRing.drain(_imageDrainBuf.begin());
+        nimu = _imuRing.drain(_imuDrainBuf.begin());
+    }
 
-    return true;
+    for(size_t i = 0; i < nimu; i++)
+    {
+        acceptImuMsg(_imuDrainBuf[i]);
+        _imuDrainBuf[i].reset();
+    }
+    for(size_t i = 0; i < nimage; i++)
+    {
+        acceptImageMsg(_imageDrainBuf[i]);
+        _imageDrainBuf[i].msg.reset();
+    }
 }
 
-void MsgSynchronizer::addImuMsg(const sensor_msgs::ImuConstPtr &imumsg)
+void MsgSynchronizer::acceptImuMsg(const sensor_msgs::ImuConstPtr &imumsg)
 {
-    unique_lock<mutex> lock(_mutexIMUQueue);
-
     if(_imageMsgDelaySec>=0) {
-        _imuMsgQueue.push(imumsg);
+        insertImuMsg(imumsg);
         if(_status == NOTINIT)
         {
             _imuMsgTimeStart = imumsg->header.stamp;
@@ -170,24 +249,21 @@ void MsgSynchronizer::addImuMsg(const sensor_msgs::ImuConstPtr &imumsg)
             // only add below images
             if(imumsg->header.stamp.toSec() + _imageMsgDelaySec > _imuMsgTimeStart.toSec())
             {
-                _imuMsgQueue.push(imumsg);
+                insertImuMsg(imumsg);
                 _status = NORMAL;
             }
         }
         else
         {
             // push message into queue
-            _imuMsgQueue.push(imumsg);
+            insertImuMsg(imumsg);
         }
     }
-
-
 }
 
-void MsgSynchronizer::addImageMsg(const sensor_msgs::ImageConstPtr &imgmsg)
+void MsgSynchronizer::acceptImageMsg(const QueuedImage &image)
 {
-    unique_lock<mutex> lock(_mutexImageQueue);
-
+    const sensor_msgs::ImageConstPtr &imgmsg = image.msg;
     if(_imageMsgDelaySec >= 0) {
         // if there's no imu messages, don't add image
         if(_status == NOTINIT)
@@ -198,14 +274,14 @@ void MsgSynchronizer::addImageMsg(const sensor_msgs::ImageConstPtr &imgmsg)
             // only add below images
             if(imgmsg->header.stamp.toSec() - _imageMsgDelaySec > _imuMsgTimeStart.toSec())
             {
-                _imageMsgQueue.push(imgmsg);
+                pushImageMsg(image);
                 _status = NORMAL;
             }
         }
         else
         {
             // push message into queue
-            _imageMsgQueue.push(imgmsg);
+            pushImageMsg(image);
         }
     }
     else {  // start by image message
@@ -216,18 +292,122 @@ void MsgSynchronizer::addImageMsg(const sensor_msgs::ImageConstPtr &imgmsg)
         }
         else
         {   // no image data if there's no imu message
-            _imageMsgQueue.push(imgmsg);
+            pushImageMsg(image);
         }
 
     }
+}
+
+
+void MsgSynchronizer::insertImuMsg(const sensor_msgs::ImuConstPtr &imumsg)
+{
+    const int64_t stampNs = (int64_t)imumsg->header.stamp.toNSec();
+
+    // in order, the common case
+    if(_imuStampsNs.empty() || stampNs >= _imuStampsNs.back())
+    {
+        _imuStampsNs.push_back(stampNs);
+        _imuMsgs.push_back(imumsg);
+        return;
+    }
+
+    // out of order, too late if its interval was already handed out
+    if(stampNs < _lastImageStampNs)
+    {
+        _imuLateCnt++;
+        return;
+    }
+    std::vector<int64_t>::iterator it = std::upper_bound(_imuStampsNs.begin() + _imuHead, _imuStampsNs.end(), stampNs);
+    const size_t idx = it - _imuStampsNs.begin();
+    _imuStampsNs.insert(it, stampNs);
+    _imuMsgs.insert(_imuMsgs.begin() + idx, imumsg);
+}
+
+void MsgSynchronizer::getImuSample(size_t i, ImuSample &sample) const
+{
+    sample.stampNs = _imuStampsNs[i];
+    sample.angular_velocity = _imuMsgs[i]->angular_velocity;
+    sample.linear_acceleration = _imuMsgs[i]->linear_acceleration;
+}
+
+void interpolateImuSample(const ImuSample &a, const ImuSample &b, int64_t stampNs, ImuSample &out)
+{
+    const double s = b.stampNs > a.stampNs ? (double)(stampNs - a.stampNs) / (double)(b.stampNs - a.stampNs) : 0.;
+    out.stampNs = stampNs;
+    out.angular_velocity.x = a.angular_velocity.x + s * (b.angular_velocity.x - a.angular_velocity.x);
+    out.angular_velocity.y = a.angular_velocity.y + s * (b.angular_velocity.y - a.angular_velocity.y);
+    out.angular_velocity.z = a.angular_velocity.z + s * (b.angular_velocity.z - a.angular_velocity.z);
+    out.linear_acceleration.x = a.linear_acceleration.x + s * (b.linear_acceleration.x - a.linear_acceleration.x);
+    out.linear_acceleration.y = a.linear_acceleration.y + s * (b.linear_acceleration.y - a.linear_acceleration.y);
+    out.linear_acceleration.z = a.linear_acceleration.z + s * (b.linear_acceleration.z - a.linear_acceleration.z);
+}
+
+void MsgSynchronizer::compactImuBuffer(void)
+{
+    if(_imuHead == 0)
+        return;
+    _imuStampsNs.erase(_imuStampsNs.begin(), _imuStampsNs.begin() + _imuHead);
+    _imuMsgs.erase(_imuMsgs.begin(), _imuMsgs.begin() + _imuHead);
+    _imuHead = 0;
+}
+
+void MsgSynchronizer::setDropPolicy(DropPolicy policy, double latencyBudgetSec)
+{
+    _dropPolicy = policy;
+    _latencyBudgetSec = latencyBudgetSec;
+}
+
+void MsgSynchronizer::reportProcessingTime(double sec)
+{
+    // only the tracker writes, a plain load/store is enough
+    const double avg = _processingTimeSec.load(std::memory_order_relaxed);
+    _processingTimeSec.store(avg > 0 ? 0.9*avg + 0.1*sec : sec, std::memory_order_relaxed);
+}
+
+bool MsgSynchronizer::parseDropPolicy(const std::string &name, DropPolicy &policy)
+{
+    if(name == "keep_all")
+        policy = KEEP_ALL;
+    else if(name == "drop_oldest")
+        policy = DROP_OLDEST;
+    else if(name == "latest")
+        policy = DROP_TO_LATEST;
+    else
+        return false;
+    return true;
+}
+
+void MsgSynchronizer::applyDropPolicy(void)
+{
+    const double processingTime = _processingTimeSec.load(std::memory_order_relaxed);
+    if(_dropPolicy == KEEP_ALL || processingTime <= 0 || _imageMsgQueue.size() < 2)
+        return;
+
+    // the newest image is processed after everything queued before it, here and in the pipeline
+    const size_t pipelineFrames = (size_t)std::max(0, _pipelineFrames.load(std::memory_order_relaxed));
+    if((_imageMsgQueue.size() + pipelineFrames) * processingTime <= _latencyBudgetSec)
+        return;
+
+    size_t keep = 1;
+    if(_dropPolicy == DROP_OLDEST)
+    {
+        const size_t fit = (size_t)(_latencyBudgetSec / processingTime);
+        keep = fit > pipelineFrames + 1 ? fit - pipelineFrames : 1;
+    }
 
-#ifdef RUN_REALTIME
-    // Ignore earlier frames
-    if(_imageMsgQueue.size()>2)
-        _imageMsgQueue.pop();
-#endif
+    while(_imageMsgQueue.size() > keep)
+    {
+        _imageMsgQueue.pop_front();
+        _droppedImageCnt++;
+    }
 }
 
+void MsgSynchronizer::pushImageMsg(const QueuedImage &image)
+{
+    if(_imageMsgQueue.full())
+        _imageMsgQueue.set_capacity(2 * _imageMsgQueue.capacity());
+    _imageMsgQueue.push_back(image);
+}
 
 void MsgSynchronizer::imageCallback(const sensor_msgs::ImageConstPtr& msg)
 {
@@ -241,8 +421,11 @@ void MsgSynchronizer::imuCallback(const sensor_msgs::ImuConstPtr &msg)
 
 void MsgSynchronizer::clearMsgs(void)
 {
-    _imuMsgQueue = std::queue<sensor_msgs::ImuConstPtr>();
-    _imageMsgQueue = std::queue<sensor_msgs::ImageConstPtr>();
+    _imuStampsNs.clear();
+    _imuMsgs.clear();
+    _imuHead = 0;
+    _lastImageStampNs = -1;
+    _imageMsgQueue.clear();
 //    while(!_imageMsgQueue.empty())
 //    {
 //        _imageMsgQueue.pop();
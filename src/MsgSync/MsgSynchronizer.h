@@ -6,12 +6,55 @@
 #include <queue>
 #include <nav_msgs/Odometry.h>
 #include <sensor_msgs/Imu.h>
+#include <vector>
 #include <mutex>
+#include <atomic>
+#include <condition_variable>
+
+#include <boost/circular_buffer.hpp>
+
+#include "SPSCRingBuffer.h"
 
 using namespace std;
 
 namespace dso_vi
 {
+// imu sample synthesized by linear interpolation between two messages
+struct ImuSample
+{
+    ImuSample(): stampNs(0) {}
+
+    int64_t stampNs;
+    geometry_msgs::Vector3 angular_velocity;
+    geometry_msgs::Vector3 linear_acceleration;
+};
+
+// linear interpolation of a and b at stampNs
+void interpolateImuSample(const ImuSample &a, const ImuSample &b, int64_t stampNs, ImuSample &out);
+
+// view into the synchronizer's IMU buffer, no copy.
+// only valid until the next call of MsgSynchronizer::getRecentMsgs
+// The messages lie strictly inside the image interval, front and back are
+// interpolated at its ends, so front, msgs..., back covers exactly [t_prev, t_img].
+struct ImuMsgSpan
+{
+    ImuMsgSpan(): msgs(NULL), stampsNs(NULL), count(0), hasFront(false) {}
+
+    const sensor_msgs::ImuConstPtr *begin(void) const {return msgs;}
+    const sensor_msgs::ImuConstPtr *end(void) const {return msgs + count;}
+    const sensor_msgs::ImuConstPtr &operator[](size_t i) const {return msgs[i];}
+    size_t size(void) const {return count;}
+    bool empty(void) const {return count == 0;}
+
+    const sensor_msgs::ImuConstPtr *msgs;
+    const int64_t *stampsNs;   // header stamps in nanoseconds, sorted
+    size_t count;
+
+    ImuSample front;    // at t_prev - delay, missing for the first image
+    ImuSample back;     // at t_img - delay
+    bool hasFront;
+};
+
 class MsgSynchronizer
 {
 public:
@@ -21,19 +64,33 @@ public:
         NORMAL
     };
 
-    MsgSynchronizer(const double& imagedelay = 0.);
+    // what to do with queued images when the tracker can't keep up
+    enum DropPolicy{
+        KEEP_ALL = 0,     // never drop
+        DROP_OLDEST,      // drop the oldest images until the backlog fits into the latency budget
+        DROP_TO_LATEST    // skip to the newest image once the backlog exceeds the latency budget
+    };
+
+    MsgSynchronizer(const double& imagedelay = 0., size_t imageBufferSize = 64, size_t imuBufferSize = 4096);
     ~MsgSynchronizer();
 
-    // add messages in callbacks
+    // add messages in callbacks, wait-free.
+    // Each stream must have a single producer (ROS serializes callbacks of one subscription)
     void addImageMsg(const sensor_msgs::ImageConstPtr &imgmsg);
     void addImuMsg(const sensor_msgs::ImuConstPtr &imumsg);
 
-    // loop in main function to handle all messages
-    bool getRecentMsgs(sensor_msgs::ImageConstPtr &imgmsg, std::vector<sensor_msgs::ImuConstPtr> &vimumsgs);
-    //int getImageMsgSize(void);
+    // loop in main function to handle all messages, single consumer.
+    // vimumsgs covers [t_prev - delay, t_img - delay], see ImuMsgSpan
+    bool getRecentMsgs(sensor_msgs::ImageConstPtr &imgmsg, ImuMsgSpan &vimumsgs);
 
     void clearMsgs(void);
 
+    // block the consumer until getRecentMsgs may return a complete image+imu bundle,
+    // returns false on timeout or shutdown
+    bool waitForMsgs(double timeoutSec);
+    // wake up and release waitForMsgs
+    void shutdown(void);
+
     // for message callback if needed
     void imageCallback(const sensor_msgs::ImageConstPtr& msg);
     void imuCallback(const sensor_msgs::ImuConstPtr& msg);
@@ -41,17 +98,93 @@ public:
     //
     inline Status getStatus(void) {return _status;}
 
-    double getImageDelaySec(void) const {return _imageMsgDelaySec;}
+    double getImageDelaySec(void) const {return _imageMsgDelaySec.load(std::memory_order_relaxed);}
+    // any thread, used from the next image on
+    void setImageDelaySec(double delaySec) {_imageMsgDelaySec.store(delaySec, std::memory_order_relaxed);}
+
+    // frame dropping, the imu samples of dropped images go to the next delivered one
+    void setDropPolicy(DropPolicy policy, double latencyBudgetSec);
+    // per frame processing time measured by the consumer, drives the drop policy
+    void reportProcessingTime(double sec);
+    // frames handed out by getRecentMsgs that still wait or are tracked further down the
+    // pipeline, any thread. They count into the backlog of the drop policy
+    void addPipelineFrames(int cnt) {_pipelineFrames.fetch_add(cnt, std::memory_order_relaxed);}
+    uint64_t getDroppedImageCnt(void) const {return _droppedImageCnt;}
+    // "keep_all", "drop_oldest" or "latest"
+    static bool parseDropPolicy(const std::string &name, DropPolicy &policy);
+
+    // number of messages rejected because the ring buffer was full
+    uint64_t getImageOverflowCnt(void) const {return _imageRing.getOverflowCnt();}
+    uint64_t getImuOverflowCnt(void) const {return _imuRing.getOverflowCnt();}
+    // number of imu messages dropped because they arrived after their interval was handed out
+    uint64_t getImuLateCnt(void) const {return _imuLateCnt;}
+
+    // stamp images with latencyNowNs() when they're added, off by default. Set before the first message
+    void setStampArrival(bool stampArrival) {_stampArrival = stampArrival;}
+    // arrival stamp of the image last returned by getRecentMsgs, 0 if not stamped
+    int64_t getLastImageArrivalNs(void) const {return _lastImageArrivalNs;}
 
 private:
-    double _imageMsgDelaySec;  // image message delay to imu message, in seconds
-    std::mutex _mutexImageQueue;
-    std::queue<sensor_msgs::ImageConstPtr> _imageMsgQueue;
-    std::mutex _mutexIMUQueue;
-    std::queue<sensor_msgs::ImuConstPtr> _imuMsgQueue;
+    struct QueuedImage
+    {
+        QueuedImage(): arrivalNs(0) {}
+
+        sensor_msgs::ImageConstPtr msg;
+        int64_t arrivalNs;
+    };
+
+    // move everything the producers pushed into the consumer side queues
+    void drainRings(void);
+    void acceptImageMsg(const QueuedImage &image);
+    void acceptImuMsg(const sensor_msgs::ImuConstPtr &imumsg);
+    void pushImageMsg(const QueuedImage &image);
+    void insertImuMsg(const sensor_msgs::ImuConstPtr &imumsg);
+    // drop the already handed out imu samples from the front of the buffer
+    void compactImuBuffer(void);
+    void notifyConsumer(void);
+    // sample of the imu buffer at index i
+    void getImuSample(size_t i, ImuSample &sample) const;
+    void applyDropPolicy(void);
+
+    std::atomic<double> _imageMsgDelaySec;  // image message delay to imu message, in seconds
+
+    // producer -> consumer hand-off
+    SPSCRingBuffer<QueuedImage> _imageRing;
+    SPSCRingBuffer<sensor_msgs::ImuConstPtr> _imuRing;
+    std::vector<QueuedImage> _imageDrainBuf;
+    std::vector<sensor_msgs::ImuConstPtr> _imuDrainBuf;
+
+    // only touched by the consumer
+    // grows only if images pile up beyond its capacity
+    boost::circular_buffer<QueuedImage> _imageMsgQueue;
+    // imu buffer sorted by time, _imuHead is the first sample not handed out yet
+    std::vector<int64_t> _imuStampsNs;
+    std::vector<sensor_msgs::ImuConstPtr> _imuMsgs;
+    size_t _imuHead;
+    int64_t _lastImageStampNs;
+    ImuSample _lastBoundarySample;  // interpolated at _lastImageStampNs, front of the next span
+    uint64_t _imuLateCnt;
+    bool _stampArrival;
+    int64_t _lastImageArrivalNs;
+
     ros::Time _imuMsgTimeStart;
     Status _status;
-    int _dataUnsyncCnt;
+
+    DropPolicy _dropPolicy;
+    double _latencyBudgetSec;
+    std::atomic<double> _processingTimeSec;   // moving average, written by the tracker
+    std::atomic<int> _pipelineFrames;
+    uint64_t _droppedImageCnt;
+
+    // consumer wake-up. Images always wake it, imu messages only once their stamp
+    // reaches _wakeImuStampNs, the point the pending image waits for.
+    std::mutex _wakeMutex;
+    std::condition_variable _wakeCond;
+    uint64_t _wakeSeq;
+    uint64_t _wakeSeqSeen;
+    bool _shutdown;
+    std::atomic<int64_t> _wakeImuStampNs;
+    bool _lastGetSucceeded;
 };
 
 }
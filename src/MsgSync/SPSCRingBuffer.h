@@ -0,0 +1,95 @@
+#ifndef SPSCRINGBUFFER_H
+#define SPSCRINGBUFFER_H
+
+#include <atomic>
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace dso_vi
+{
+// Bounded single-producer/single-consumer ring buffer.
+// push() is wait-free and never allocates: storage is preallocated in the constructor.
+// When the buffer is full the new item is rejected and counted as an overflow.
+template<typename T>
+class SPSCRingBuffer
+{
+public:
+    // capacity is rounded up to the next power of two
+    explicit SPSCRingBuffer(size_t capacity):
+        _head(0), _tail(0), _overflowCnt(0), _pushCnt(0)
+    {
+        size_t size = 2;
+        while(size < capacity)
+            size <<= 1;
+        _buffer.resize(size);
+        _mask = size - 1;
+    }
+
+    // producer side
+    bool push(const T &item)
+    {
+        const size_t tail = _tail.load(std::memory_order_relaxed);
+        if(tail - _head.load(std::memory_order_acquire) > _mask)
+        {
+            _overflowCnt.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        _buffer[tail & _mask] = item;
+        _tail.store(tail + 1, std::memory_order_release);
+        _pushCnt.fetch_add(1, std::memory_order_relaxed);
+        return true;
+    }
+
+    // consumer side, move up to maxItems items into out, returns the number of items moved.
+    // Slots are reset so that the buffer doesn't keep references (e.g. message pointers) alive.
+    template<typename OutputIt>
+    size_t drain(OutputIt out, size_t maxItems = SIZE_MAX)
+    {
+        const size_t head = _head.load(std::memory_order_relaxed);
+        const size_t tail = _tail.load(std::memory_order_acquire);
+        size_t n = tail - head;
+        if(n > maxItems)
+            n = maxItems;
+
+        for(size_t i = 0; i < n; i++)
+        {
+            T &slot = _buffer[(head + i) & _mask];
+            *out++ = slot;
+            slot = T();
+        }
+        _head.store(head + n, std::memory_order_release);
+        return n;
+    }
+
+    // approximate when called concurrently with push/drain
+    size_t size(void) const
+    {
+        return _tail.load(std::memory_order_acquire) - _head.load(std::memory_order_acquire);
+    }
+    bool empty(void) const {return size() == 0;}
+    size_t capacity(void) const {return _mask + 1;}
+
+    uint64_t getOverflowCnt(void) const {return _overflowCnt.load(std::memory_order_relaxed);}
+    uint64_t getPushCnt(void) const {return _pushCnt.load(std::memory_order_relaxed);}
+
+private:
+    SPSCRingBuffer(const SPSCRingBuffer&);
+    SPSCRingBuffer& operator=(const SPSCRingBuffer&);
+
+    std::vector<T> _buffer;
+    size_t _mask;
+
+    // keep producer and consumer indices on separate cache lines
+    char _pad0[64];
+    std::atomic<size_t> _head;  // written by consumer only
+    char _pad1[64];
+    std::atomic<size_t> _tail;  // written by producer only
+    char _pad2[64];
+    std::atomic<uint64_t> _overflowCnt;
+    std::atomic<uint64_t> _pushCnt;
+};
+
+}
+
+#endif // SPSCRINGBUFFER_H
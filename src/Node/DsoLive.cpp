@@ -0,0 +1,773 @@
+/**
+* This file is part of DSO.
+* 
+* Copyright 2016 Technical University of Munich and Intel.
+* Developed by Jakob Engel <engelj at in dot tum dot de>,
+* for more information see <http://vision.in.tum.de/dso>.
+* If you use this code, please cite the respective publications as
+* listed on the above website.
+*
+* DSO is free software: you can redistribute it and/or modify
+* it under the terms of the GNU General Public License as published by
+* the Free Software Foundation, either version 3 of the License, or
+* (at your option) any later version.
+*
+* DSO is distributed in the hope that it will be useful,
+* but WITHOUT ANY WARRANTY; without even the implied warranty of
+* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the
+* GNU General Public License for more details.
+*
+* You should have received a copy of the GNU General Public License
+* along with DSO. If not, see <http://www.gnu.org/licenses/>.
+*/
+
+
+/* 
+ *
+ * If CMake can't find mkl:
+ * << source /opt/intel/bin/compilervars.sh intel64
+ */
+#ifndef MKL_BLAS
+#define MKL_BLAS MKL_DOMAIN_BLAS
+#endif
+
+#include "Node/DsoLive.h"
+
+#include <stdlib.h>
+#include <stdio.h>
+#include <stdexcept>
+#include <iostream>
+#include <chrono>
+#include <cmath>
+
+#include "util/settings.h"
+#include "FullSystem/FullSystem.h"
+#include "util/Undistort.h"
+#include "IOWrapper/Pangolin/PangolinDSOViewer.h"
+#include "IOWrapper/OutputWrapper/SampleOutputWrapper.h"
+
+#include "BagPlayer/BagReplayer.h"
+#include "Pipeline/UndistortPool.h"
+#include "Node/TrackedFrameWrapper.h"
+#include "Eval/GroundTruthCache.h"
+#include "Eval/Evaluator.h"
+#include "Log/LogWriter.h"
+#include "Log/LogEigen.h"
+
+#include <sensor_msgs/image_encodings.h>
+#include "cv_bridge/cv_bridge.h"
+#include <opencv2/core/core.hpp>
+
+// GTSAM related includes.
+#include <gtsam/navigation/CombinedImuFactor.h>
+#include <gtsam/navigation/GPSFactor.h>
+#include <gtsam/navigation/ImuFactor.h>
+#include <gtsam/slam/dataset.h>
+#include <gtsam/slam/BetweenFactor.h>
+#include <gtsam/slam/PriorFactor.h>
+#include <gtsam/nonlinear/LevenbergMarquardtOptimizer.h>
+#include <gtsam/nonlinear/NonlinearFactorGraph.h>
+#include <gtsam/inference/Symbol.h>
+
+using namespace dso;
+
+namespace dso_vi
+{
+
+DsoLive::DsoLive():
+	_logFile("dso_live.log"), _bagOffset(0.0), _bagReadAheadSec(0.3), _pipelineDepth(2), _useSampleOutput(false),
+	_fullSystem(0), _undistorter(0), _undistortPool(0), _config(0), _groundTruth(0),
+	_msgsync(0), _bagReplayer(0), _biasEstimator(0), _posePropagator(0), _timeOffsetEstimator(0), _trackedFrames(0), _log(0), _evaluator(0), _frameQueue(0), _stopIngest(false), _running(false),
+	_previousImageTimestamp(-1), _imuPreintegrator(0),
+	_imageCnt(0), _imageCopyCnt(0), _ingestAllocStats("ingest stage"),
+	_frameID(0), _previousTrackedTimestamp(-1), _biasVersion(0),
+	_trackAllocStats("tracking stage, without DSO"), _dsoAllocCnt(0), _frameTracked(false), _trackEndNs(0)
+{
+}
+
+DsoLive::~DsoLive()
+{
+	shutdown();
+}
+
+void DsoLive::parseArgument(const char* arg)
+{
+	int option;
+	char buf[1000];
+
+	if(1==sscanf(arg,"sampleoutput=%d",&option))
+	{
+		if(option==1)
+		{
+			_useSampleOutput = true;
+			printf("USING SAMPLE OUTPUT WRAPPER!\n");
+		}
+		return;
+	}
+
+	if(1==sscanf(arg,"quiet=%d",&option))
+	{
+		if(option==1)
+		{
+			setting_debugout_runquiet = true;
+			printf("QUIET MODE, I'll shut up!\n");
+		}
+		return;
+	}
+
+
+	if(1==sscanf(arg,"nolog=%d",&option))
+	{
+		if(option==1)
+		{
+			setting_logStuff = false;
+			printf("DISABLE LOGGING!\n");
+		}
+		return;
+	}
+
+	if(1==sscanf(arg,"nogui=%d",&option))
+	{
+		if(option==1)
+		{
+			disableAllDisplay = true;
+			printf("NO GUI!\n");
+		}
+		return;
+	}
+	if(1==sscanf(arg,"nomt=%d",&option))
+	{
+		if(option==1)
+		{
+			multiThreading = false;
+			printf("NO MultiThreading!\n");
+		}
+		return;
+	}
+	if(1==sscanf(arg,"calib=%s",buf))
+	{
+		_calib = buf;
+		printf("loading calibration from %s!\n", _calib.c_str());
+		return;
+	}
+	if(1==sscanf(arg,"vignette=%s",buf))
+	{
+		_vignetteFile = buf;
+		printf("loading vignette from %s!\n", _vignetteFile.c_str());
+		return;
+	}
+
+	if(1==sscanf(arg,"gamma=%s",buf))
+	{
+		_gammaFile = buf;
+		printf("loading gammaCalib from %s!\n", _gammaFile.c_str());
+		return;
+	}
+
+	if(1==sscanf(arg,"config=%s",buf))
+	{
+		_configFile = buf;
+		printf("loading config from %s!\n", _configFile.c_str());
+		return;
+	}
+
+	if(1==sscanf(arg,"groundtruth=%s",buf))
+	{
+		_groundTruthFile = buf;
+		printf("loading groundTruth from %s!\n", _groundTruthFile.c_str());
+		return;
+	}
+
+	if(1==sscanf(arg,"latency=%d",&option))
+	{
+		if(option==1)
+		{
+			_latency.setEnabled(true);
+			printf("MEASURING STAGE LATENCY!\n");
+		}
+		return;
+	}
+
+	if(1==sscanf(arg,"log=%s",buf))
+	{
+		_logFile = buf;
+		printf("logging to %s!\n", _logFile.c_str());
+		return;
+	}
+
+	if(1==sscanf(arg,"bag=%s",buf))
+	{
+		_bagFile = buf;
+		printf("loading bag from %s!\n", _bagFile.c_str());
+		return;
+	}
+
+	if(1==sscanf(arg,"pipeline_depth=%d",&option))
+	{
+		_pipelineDepth = option > 0 ? option : 1;
+		printf("Pipeline depth %d!\n", _pipelineDepth);
+		return;
+	}
+
+	if(1==sscanf(arg,"readahead=%d",&option))
+	{
+		_bagReadAheadSec = option > 0 ? option * 1e-3 : 0;
+		printf("Bag read-ahead %dms!\n", option);
+		return;
+	}
+
+	if(1==sscanf(arg,"bag_offset=%s",buf))
+	{
+		_bagOffset = atof(buf);
+		printf("Bag offset %f!\n", _bagOffset);
+		return;
+	}
+
+	printf("could not parse argument \"%s\"!!\n", arg);
+}
+
+bool DsoLive::init(void)
+{
+	if (_configFile.empty())
+	{
+		printf("Config file location missing\n");
+		return false;
+	}
+
+	// optional, without it there is no evaluation.
+	// parsed once, or mapped from the cache written next to it
+	if (!_groundTruthFile.empty())
+	{
+		GroundTruthCache* groundTruth = new GroundTruthCache(_groundTruthFile);
+		if (!groundTruth->isValid())
+		{
+			printf("could not load ground truth from %s\n", _groundTruthFile.c_str());
+			delete groundTruth;
+			return false;
+		}
+		_groundTruth = groundTruth;
+	}
+
+	setting_desiredImmatureDensity = 1000;
+	setting_desiredPointDensity = 1200;
+	setting_minFrames = 5;
+	setting_maxFrames = 7;
+	setting_maxOptIterations=4;
+	setting_minOptIterations=1;
+	setting_logStuff = false;
+	setting_kfGlobalWeight = 1.3;
+
+
+	printf("MODE WITH CALIBRATION, but without exposure times!\n");
+	setting_photometricCalibration = 2;
+	setting_affineOptModeA = 0;
+	setting_affineOptModeB = 0;
+
+
+
+    _undistorter = Undistort::getUndistorterForFile(_calib, _gammaFile, _vignetteFile);
+
+    setGlobalCalib(
+            (int)_undistorter->getSize()[0],
+            (int)_undistorter->getSize()[1],
+            _undistorter->getK().cast<float>());
+
+    // one buffer per queued frame, plus the ones being prepared and tracked
+    _undistortPool = new UndistortPool(_undistorter, _pipelineDepth + 2);
+
+	// --------------------------------- Configs --------------------------------- //
+	_config = new ConfigParam(_configFile);
+
+	dso_vi::accel_noise_sigma = _config->Getaccel_noise_sigma();
+	dso_vi::gyro_noise_sigma = _config->Getgyro_noise_sigma();
+	dso_vi::accel_bias_rw_sigma = _config->Getaccel_bias_rw_sigma();
+	dso_vi::gyro_bias_rw_sigma = _config->Getgyro_bias_rw_sigma();
+	// getIMUParams() reads the sigmas above
+	_imuPreintegrator = new ImuPreintegrator();
+
+	_fullSystem = new FullSystem();
+    _fullSystem->linearizeOperation=true;
+	_fullSystem->setTbc(_config->GetEigTbc());
+    _fullSystem->setBiasEstimate(_config->GetEigAccBias(), _config->GetEigGyroBias());
+    // refined online, starts from the configured bias
+    _biasEstimator = new BiasEstimator(gtsam::imuBias::ConstantBias(_config->GetEigAccBias(), _config->GetEigGyroBias()));
+	_fullSystem->addprior = _config->Getaddprior();
+	_fullSystem->addimu = _config->Getaddimu();
+	_fullSystem->WINDOW_SIZE = 40;
+
+
+	if(!disableAllDisplay)
+	    _fullSystem->outputWrapper.push_back(new IOWrap::PangolinDSOViewer(
+	    		 (int)_undistorter->getSize()[0],
+	    		 (int)_undistorter->getSize()[1]));
+
+
+    if(_useSampleOutput)
+        _fullSystem->outputWrapper.push_back(new IOWrap::SampleOutputWrapper());
+
+    // deleted with the other wrappers
+    _trackedFrames = new TrackedFrameWrapper();
+    _fullSystem->outputWrapper.push_back(_trackedFrames);
+
+
+    if(_undistorter->photometricUndist != 0)
+    	_fullSystem->setGammaFunction(_undistorter->photometricUndist->getG());
+
+    _msgsync = new MsgSynchronizer( _config->GetImageDelayToIMU() );
+    _msgsync->setStampArrival(_latency.isEnabled());
+
+    // frame dropping, not part of ConfigParam. Off unless test.DropPolicy asks for it,
+    // and always off for bag input, which is replayed as fast as the tracker goes
+    {
+        cv::FileStorage fSettings(_configFile, cv::FileStorage::READ);
+        std::string policyName = (std::string)fSettings["test.DropPolicy"];
+        double budgetMs = (double)fSettings["test.LatencyBudgetMs"];
+
+        MsgSynchronizer::DropPolicy policy = MsgSynchronizer::KEEP_ALL;
+        if (!_bagFile.empty() || policyName.empty())
+            policyName = "keep_all";
+        if (!MsgSynchronizer::parseDropPolicy(policyName, policy))
+            printf("unknown test.DropPolicy \"%s\"\n", policyName.c_str());
+        if (budgetMs <= 0)
+            budgetMs = 100;
+        if (policy == MsgSynchronizer::KEEP_ALL)
+            printf("frame dropping: off%s\n", _bagFile.empty() ? "" : " for bag input");
+        else
+            printf("frame dropping: %s, latency budget %.1fms\n", policyName.c_str(), budgetMs);
+        _msgsync->setDropPolicy(policy, budgetMs * 1e-3);
+
+        // on unless switched off
+        cv::FileNode estimateDelay = fSettings["Camera.EstimateDelay"];
+        if (estimateDelay.empty() || (int)estimateDelay != 0)
+            _timeOffsetEstimator = new TimeOffsetEstimator(_config->GetImageDelayToIMU());
+    }
+
+    // logging, written on the log's own thread. dso_log_convert turns it into text
+    _log = new LogWriter(_logFile);
+    if (_groundTruth)
+        _evaluator = new Evaluator(*_groundTruth, _config->GetEigTbc().block<3,3>(0,0), *_log);
+
+    // frames are prepared on the ingest thread and tracked on _trackingThread
+    _frameQueue = new BoundedQueue<PreparedFrame>(_pipelineDepth);
+    _trackingThread = std::thread(&DsoLive::trackingLoop, this);
+    _running = true;
+
+    return true;
+}
+
+void DsoLive::subscribe(ros::NodeHandle &nh)
+{
+	// the callbacks run on the spinner threads (or the nodelet manager's), one per subscription
+	ROS_INFO("Subscribing %s and %s", _config->_imageTopic.c_str(), _config->_imuTopic.c_str());
+	_odomPub = nh.advertise<nav_msgs::Odometry>("imu_odometry", 200);
+	_posePropagator = new PosePropagator(_odomPub, "world", "imu");
+	_imgSub = nh.subscribe(_config->_imageTopic, 2, &MsgSynchronizer::imageCallback, _msgsync);
+	_imuSub = nh.subscribe(_config->_imuTopic, 200, &DsoLive::imuCallback, this);
+	if (_latency.isEnabled())
+		_latencyService = nh.advertiseService("print_latency", &DsoLive::printLatency, this);
+}
+
+bool DsoLive::printLatency(std_srvs::Empty::Request &request, std_srvs::Empty::Response &response)
+{
+	_latency.print();
+	return true;
+}
+
+void DsoLive::imuCallback(const sensor_msgs::ImuConstPtr &msg)
+{
+	_msgsync->addImuMsg(msg);
+	_posePropagator->addImuMsg(msg);
+}
+
+void DsoLive::startLive(ros::NodeHandle &nh)
+{
+	subscribe(nh);
+	_ingestThread = std::thread(&DsoLive::ingestLoop, this);
+}
+
+void DsoLive::runLive(ros::NodeHandle &nh)
+{
+	subscribe(nh);
+	ingestLoop();
+}
+
+void DsoLive::ingestLoop(void)
+{
+	// sleeps until the synchronizer has a complete bundle
+	while (!_stopIngest && ros::ok())
+	{
+		if (step())
+		{
+			break;
+		}
+		_msgsync->waitForMsgs(0.1);
+	}
+}
+
+void DsoLive::runBag(void)
+{
+	_bagReplayer = new BagReplayer(_bagFile, _config->_imageTopic, _config->_imuTopic, _bagOffset, _bagReadAheadSec);
+	_bagReplayer->play(*_msgsync, [this]() {
+		return !_stopIngest && step() == 0;
+	});
+	_bagReplayer->printStats();
+}
+
+void DsoLive::shutdown(void)
+{
+	if (!_running)
+		return;
+	_running = false;
+
+	_imgSub.shutdown();
+	_imuSub.shutdown();
+	_latencyService.shutdown();
+
+	_stopIngest = true;
+	_msgsync->shutdown();
+	if (_ingestThread.joinable())
+		_ingestThread.join();
+
+	// let the tracker finish the frames already prepared
+	_frameQueue->close();
+	_trackingThread.join();
+	delete _frameQueue;
+	_frameQueue = 0;
+
+	gtsam::imuBias::ConstantBias bias = _biasEstimator->getBias();
+	printf("final gyro bias estimate %f %f %f\n", bias.gyroscope().x(), bias.gyroscope().y(), bias.gyroscope().z());
+	printf("final image delay %.2fms\n", _msgsync->getImageDelaySec()*1e3);
+	delete _biasEstimator;
+	delete _timeOffsetEstimator;
+	delete _imuPreintegrator;
+	_imuPreintegrator = 0;
+
+	if (_posePropagator)
+	{
+		printf("%lu imu rate poses published\n", (unsigned long)_posePropagator->getPublishedCnt());
+		delete _posePropagator;
+		_posePropagator = 0;
+	}
+	_odomPub.shutdown();
+
+	printf("%d of %d images took the copy path\n", _imageCopyCnt, _imageCnt);
+	_ingestAllocStats.print();
+	_trackAllocStats.print();
+	printf("%lu images dropped by the synchronizer\n", (unsigned long)_msgsync->getDroppedImageCnt());
+	_latency.print();
+
+    for(IOWrap::Output3DWrapper* ow : _fullSystem->outputWrapper)
+    {
+        ow->join();
+        delete ow;
+    }
+
+    delete _undistortPool;
+    delete _undistorter;
+    delete _fullSystem;
+
+    delete _bagReplayer;
+    if (_evaluator)
+    {
+        _evaluator->shutdown();
+        printf("%lu frames evaluated, %lu dropped\n", (unsigned long)_evaluator->getEvaluatedCnt(), (unsigned long)_evaluator->getDroppedCnt());
+        printf("%lu ground truth lookups fell into gaps\n", (unsigned long)_groundTruth->getGapCnt());
+        delete _evaluator;
+    }
+    _log->shutdown();
+    printf("%lu log records written to %s, %lu dropped\n", (unsigned long)_log->getRecordCnt(), _logFile.c_str(), (unsigned long)_log->getDroppedCnt());
+    delete _log;
+    delete _groundTruth;
+    _groundTruth = 0;
+    delete _msgsync;
+    delete _config;
+}
+
+void DsoLive::track(PreparedFrame &frame)
+{
+	if(setting_fullResetRequested)
+	{
+		std::vector<IOWrap::Output3DWrapper*> wraps = _fullSystem->outputWrapper;
+		delete _fullSystem;
+		for(IOWrap::Output3DWrapper* ow : wraps) ow->reset();
+		_fullSystem = new FullSystem();
+        _fullSystem->setTbc(_config->GetEigTbc());
+		_fullSystem->linearizeOperation=false;
+		_fullSystem->outputWrapper = wraps;
+	    if(_undistorter->photometricUndist != 0)
+	    	_fullSystem->setGammaFunction(_undistorter->photometricUndist->getG());
+		gtsam::imuBias::ConstantBias bias = _biasEstimator->getBias();
+		_fullSystem->setBiasEstimate(bias.accelerometer(), bias.gyroscope());
+		setting_fullResetRequested=false;
+	}
+
+	// the ingest stage preintegrates with the estimate too
+	const uint64_t biasVersion = _biasEstimator->getVersion();
+	if(biasVersion != _biasVersion)
+	{
+		gtsam::imuBias::ConstantBias bias = _biasEstimator->getBias();
+		_fullSystem->setBiasEstimate(bias.accelerometer(), bias.gyroscope());
+		_biasVersion = biasVersion;
+	}
+
+	std::vector<dso_vi::IMUData> &vimuData = frame.vimuData;
+	ImageAndExposure* undistImg = frame.undistImg;
+	const int trackedFrameCnt = _trackedFrames->getFrameCnt();
+	const uint64_t dsoAllocStart = getThreadAllocCnt();
+	const int64_t trackStartNs = _latency.isEnabled() ? latencyNowNs() : 0;
+	_fullSystem->addActiveFrame(undistImg, _frameID, vimuData, frame.timestamp, *_config, frame.groundtruth);
+	if (_latency.isEnabled())
+	{
+		_trackEndNs = latencyNowNs();
+		_latency.record(PipelineLatency::TRACK, trackStartNs, _trackEndNs);
+	}
+	_dsoAllocCnt = getThreadAllocCnt() - dsoAllocStart;
+	// DSO publishes the pose of every frame it tracked
+	const bool tracked = _trackedFrames->getFrameCnt() != trackedFrameCnt;
+	_frameTracked = tracked;
+
+    _frameID++;
+    const double previousTimestamp = _previousTrackedTimestamp;
+    _previousTrackedTimestamp = frame.timestamp;
+
+    if (_timeOffsetEstimator)
+    {
+        const Eigen::Vector3d gyroBias = frame.imuBias.gyroscope();
+        for (const dso_vi::IMUData &imudata : vimuData)
+            _timeOffsetEstimator->addGyro(imudata._t, imudata._g - gyroBias);
+    }
+
+     //-------------------- Get relative pose -------------------- //
+    FrameShell* scurrent = tracked ? _trackedFrames->getCurrent() : 0;
+    FrameShell* slast = tracked ? _trackedFrames->getPrevious() : 0;
+    Eigen::Matrix<double,4,4> Tbc = _config->GetEigTbc();
+
+    if (scurrent && scurrent->poseValid)
+    {
+        LogFramePose pose;
+        pose.timestamp = frame.timestamp;
+        Eigen::Map<Eigen::Vector3d>(pose.t) = scurrent->camToWorld.translation();
+        toLog(scurrent->camToWorld.so3().unit_quaternion(), pose.q);
+        _log->write(pose);
+    }
+    if (previousTimestamp > 0)
+    {
+        LogImuDelta delta;
+        delta.previousTimestamp = previousTimestamp;
+        delta.timestamp = frame.timestamp;
+        toLog(frame.imuDeltaR.toQuaternion(), delta.q);
+        Eigen::Map<Eigen::Vector3d>(delta.gyroBias) = frame.imuBias.gyroscope();
+        _log->write(delta);
+    }
+
+    // the imu rate output restarts from every tracked pose
+    if (_posePropagator && _fullSystem->initialized && scurrent && scurrent->poseValid)
+    {
+        gtsam::Pose3 Tcb = gtsam::Pose3(gtsam::Rot3(Tbc.block<3,3>(0,0)), gtsam::Point3(Tbc.block<3,1>(0,3))).inverse();
+        gtsam::Pose3 Twc(gtsam::Rot3(scurrent->camToWorld.rotationMatrix()), gtsam::Point3(scurrent->camToWorld.translation()));
+        _posePropagator->setVisualPose(
+            frame.timestamp - _msgsync->getImageDelaySec(),
+            Twc.compose(Tcb),
+            _biasEstimator->getBias().gyroscope()
+        );
+    }
+    if (!_fullSystem->initialized || _trackedFrames->getFrameCnt() < 100)
+    {
+        return;
+    }
+    if (!scurrent || !slast || !scurrent->poseValid || !slast->poseValid)
+    {
+        return;
+    }
+    SE3 scurrent_2_slast = slast->camToWorld.inverse() * scurrent->camToWorld;
+    gtsam::Rot3 dsoDeltaR(scurrent_2_slast.so3().matrix());
+
+    gtsam::Rot3 gtsamRbc = gtsam::Rot3(Tbc.block<3,3>(0,0));
+    gtsam::Rot3 gtsamRcb = gtsamRbc.inverse();
+
+    // DSO's rotation in the body frame drives the bias and delay estimates
+    gtsam::Rot3 visualDeltaR = gtsamRbc.compose(dsoDeltaR).compose(gtsamRcb);
+    _biasEstimator->addInterval(frame.imuDeltaR, frame.imuDelRdelBiasOmega, frame.imuBias.gyroscope(), visualDeltaR);
+
+    if (_timeOffsetEstimator && previousTimestamp > 0)
+    {
+        _timeOffsetEstimator->addVisualRotation(previousTimestamp, frame.timestamp, gtsam::Rot3::Logmap(visualDeltaR));
+        // the search over the window is cheap, but there's no point in every frame
+        double delaySec;
+        if (_frameID % 20 == 0 && _timeOffsetEstimator->estimate(delaySec))
+        {
+            if (std::abs(delaySec - _msgsync->getImageDelaySec()) > 0.0005)
+                printf("image delay %.2fms -> %.2fms\n", _msgsync->getImageDelaySec()*1e3, delaySec*1e3);
+            _msgsync->setImageDelaySec(delaySec);
+        }
+    }
+
+    // the comparison with the ground truth runs on the evaluator's thread
+    if (_evaluator && previousTimestamp > 0)
+    {
+        Evaluator::Record record;
+        record.previousTimestamp = previousTimestamp;
+        record.timestamp = frame.timestamp;
+        record.dsoDeltaR = dsoDeltaR;
+        record.imuDeltaR = frame.imuDeltaR;
+        if (!_evaluator->push(record))
+            ROS_WARN_THROTTLE(5.0, "evaluator behind, record dropped");
+    }
+}
+
+void DsoLive::trackingLoop(void)
+{
+	PreparedFrame frame;
+	while(_frameQueue->pop(frame))
+	{
+		if (_latency.isEnabled())
+			_latency.record(PipelineLatency::FRAME_QUEUE, frame.latency.preparedNs, latencyNowNs());
+		std::chrono::steady_clock::time_point trackStart = std::chrono::steady_clock::now();
+		_trackAllocStats.begin();
+		track(frame);
+		_trackAllocStats.end(_dsoAllocCnt);
+		const double trackSec = std::chrono::duration<double>(std::chrono::steady_clock::now() - trackStart).count();
+		_msgsync->reportProcessingTime(trackSec);
+		_msgsync->addPipelineFrames(-1);
+
+		LogFrameTiming timing;
+		timing.timestamp = frame.timestamp;
+		timing.trackSec = trackSec;
+		timing.frameId = _frameID - 1;
+		timing.tracked = _frameTracked;
+		_log->write(timing);
+		if (_latency.isEnabled())
+		{
+			const int64_t endNs = latencyNowNs();
+			_latency.record(PipelineLatency::POST, _trackEndNs, endNs);
+			_latency.record(PipelineLatency::TOTAL, frame.latency.arrivalNs, endNs);
+			LogFrameLatency latency;
+			latency.timestamp = frame.timestamp;
+			latency.latencySec = (endNs - frame.latency.arrivalNs) * 1e-9;
+			_log->write(latency);
+		}
+
+		_undistortPool->release(frame.undistImg);
+		frame.undistImg = 0;
+	}
+}
+
+void DsoLive::prepareFrame(const sensor_msgs::ImageConstPtr img, PreparedFrame &frame)
+{
+	_imageCnt++;
+	frame.timestamp = img->header.stamp.toSec();
+	const int64_t convertStartNs = _latency.isEnabled() ? latencyNowNs() : 0;
+
+	// unpadded mono8, read straight from the message buffer
+	if(img->encoding == sensor_msgs::image_encodings::MONO8 && img->step == img->width)
+	{
+		MinimalImageB minImg((int)img->width, (int)img->height, (unsigned char*)&img->data[0]);
+		undistort(minImg, frame, convertStartNs);
+		return;
+	}
+
+	// other encodings are converted, row padding is removed by a copy
+	cv_bridge::CvImageConstPtr cv_ptr = cv_bridge::toCvShare(img, sensor_msgs::image_encodings::MONO8);
+	assert(cv_ptr->image.type() == CV_8U);
+	assert(cv_ptr->image.channels() == 1);
+
+	cv::Mat image = cv_ptr->image;
+	if(!image.isContinuous())
+		image = image.clone();
+	if(image.data != &img->data[0])
+		_imageCopyCnt++;
+
+	MinimalImageB minImg((int)image.cols, (int)image.rows,(unsigned char*)image.data);
+	undistort(minImg, frame, convertStartNs);
+}
+
+void DsoLive::undistort(MinimalImageB &minImg, PreparedFrame &frame, int64_t convertStartNs)
+{
+	if(!_latency.isEnabled())
+	{
+		frame.undistImg = _undistortPool->undistort(&minImg, 1,0, 1.0f);
+		return;
+	}
+
+	const int64_t convertEndNs = latencyNowNs();
+	frame.undistImg = _undistortPool->undistort(&minImg, 1,0, 1.0f);
+	frame.latency.preparedNs = latencyNowNs();
+	_latency.record(PipelineLatency::CONVERT, convertStartNs, convertEndNs);
+	_latency.record(PipelineLatency::UNDISTORT, convertEndNs, frame.latency.preparedNs);
+}
+
+int DsoLive::step(void)
+{
+	// 3dm imu output per g. 1g=9.80665 according to datasheet
+    const double g3dm = 9.80665;
+    const double nAccMultiplier = _config->GetAccMultiply9p8() ? g3dm : 1;
+
+	bool bdata = _msgsync->getRecentMsgs(_imageMsg, _vimuMsg);
+
+	if (bdata)
+	{
+		_ingestAllocStats.begin();
+		// recycled through the frame queue, keeps the capacity of its buffers
+		PreparedFrame &frame = _preparedFrame;
+		frame.undistImg = 0;
+		frame.vimuData.clear();
+		int64_t syncNs = 0;
+		if (_latency.isEnabled())
+		{
+			syncNs = latencyNowNs();
+			frame.latency.arrivalNs = _msgsync->getLastImageArrivalNs();
+			_latency.record(PipelineLatency::SYNC, frame.latency.arrivalNs, syncNs);
+		}
+		_imuBatch.fill(_vimuMsg, nAccMultiplier);
+
+		// the batch starts at the previous image and ends at this one, in imu time
+		frame.imuBias = _biasEstimator->getBias();
+		_imuPreintegrator->reset(frame.imuBias);
+		_imuPreintegrator->integrate(_imuBatch);
+		frame.imuDeltaR = _imuPreintegrator->deltaRij();
+		frame.imuDelRdelBiasOmega = _imuPreintegrator->getPreintegrated().delRdelBiasOmega();
+
+		// FullSystem takes its own imu data type
+		std::vector<dso_vi::IMUData> &vimuData = frame.vimuData;
+		vimuData.reserve(_imuBatch.size());
+		for (size_t i = 0; i < _imuBatch.size(); i++)
+		{
+			vimuData.push_back(
+				dso_vi::IMUData(
+					_imuBatch.gyro()(i,0), _imuBatch.gyro()(i,1), _imuBatch.gyro()(i,2),
+					_imuBatch.acc()(i,0), _imuBatch.acc()(i,1), _imuBatch.acc()(i,2),
+					_imuBatch.t()(i)
+				)
+			);
+		}
+		if (_latency.isEnabled())
+			_latency.record(PipelineLatency::IMU, syncNs, latencyNowNs());
+		ROS_DEBUG("time- %f, %ld IMU message between the images", _imageMsg->header.stamp.toSec(), vimuData.size());
+		ROS_DEBUG("Cam- %f. %f, IMU- %f, %f", _previousImageTimestamp, _imageMsg->header.stamp.toSec(), vimuData[0]._t, vimuData.back()._t);
+		if (_previousImageTimestamp > 0)
+		{
+			// DSO takes the ground truth state of the frame, a default one without
+			frame.hasGroundTruth = _groundTruth && _groundTruth->getMeasurement(_imageMsg->header.stamp.toSec(), frame.groundtruth);
+			if (!frame.hasGroundTruth)
+			{
+				frame.groundtruth = GroundTruthCache::Measurement();
+				frame.groundtruth.timestamp = _imageMsg->header.stamp.toSec();
+			}
+			prepareFrame(_imageMsg, frame);
+			// blocks while the tracker is _pipelineDepth frames behind.
+			// Counted before the push, the tracker may be done with it right after
+			_msgsync->addPipelineFrames(1);
+			if (!_frameQueue->push(frame))
+			{
+				_msgsync->addPipelineFrames(-1);
+				_undistortPool->release(frame.undistImg);
+				return 1;
+			}
+		}
+		_previousImageTimestamp = _imageMsg->header.stamp.toSec();
+		_ingestAllocStats.end();
+	}
+	return 0;
+}
+
+}
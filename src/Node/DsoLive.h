@@ -0,0 +1,169 @@
+#ifndef DSOLIVE_H
+#define DSOLIVE_H
+
+#include <string>
+#include <vector>
+#include <thread>
+#include <atomic>
+
+#include <ros/ros.h>
+#include <sensor_msgs/Image.h>
+#include <sensor_msgs/Imu.h>
+#include <std_srvs/Empty.h>
+
+#include <gtsam/geometry/Pose3.h>
+
+#include "util/ImageAndExposure.h"
+#include "util/MinimalImage.h"
+#include "GroundTruthIterator/GroundTruthIterator.h"
+#include "IMU/configparam.h"
+#include "IMU/imudata.h"
+
+#include "MsgSync/MsgSynchronizer.h"
+#include "Pipeline/BoundedQueue.h"
+#include "Pipeline/ImuPreintegrator.h"
+#include "Pipeline/ImuBatch.h"
+#include "Pipeline/BiasEstimator.h"
+#include "Pipeline/PosePropagator.h"
+#include "Pipeline/TimeOffsetEstimator.h"
+#include "Pipeline/PipelineLatency.h"
+#include "Util/AllocCounter.h"
+
+namespace dso
+{
+class FullSystem;
+class Undistort;
+}
+
+namespace dso_vi
+{
+class UndistortPool;
+class BagReplayer;
+class TrackedFrameWrapper;
+class GroundTruthCache;
+class Evaluator;
+class LogWriter;
+
+// The dso_live pipeline: MsgSynchronizer -> ingest stage -> tracking thread.
+// Shared by the standalone node and the nodelet. DSO keeps its settings and calibration
+// in globals, so there can only be one instance per process.
+class DsoLive
+{
+public:
+    DsoLive();
+    ~DsoLive();
+
+    // same key=value arguments as the dso_live command line
+    void parseArgument(const char* arg);
+
+    // load calibration and config, set up DSO. false if a required file is missing
+    bool init(void);
+
+    // live input: subscribe on nh and process on a background thread, returns immediately
+    void startLive(ros::NodeHandle &nh);
+    // live input processed on the calling thread, returns on ros shutdown or when the input ends
+    void runLive(ros::NodeHandle &nh);
+    // bag input given by bag=, blocks until the bag is done
+    void runBag(void);
+    bool hasBag(void) const {return !_bagFile.empty();}
+
+    // stop processing, finish the frames already prepared and release DSO
+    void shutdown(void);
+
+private:
+    // output of the ingest stage, everything addActiveFrame needs
+    struct PreparedFrame
+    {
+        PreparedFrame(): undistImg(0), timestamp(0), hasGroundTruth(false) {}
+
+        dso::ImageAndExposure* undistImg;
+        double timestamp;
+        std::vector<dso_vi::IMUData> vimuData;
+        bool hasGroundTruth;        // false without ground truth or in a gap
+        dso_vi::GroundTruthIterator::ground_truth_measurement_t groundtruth;
+        gtsam::Rot3 imuDeltaR;      // preintegrated rotation since the previous frame
+        Eigen::Matrix3d imuDelRdelBiasOmega;
+        gtsam::imuBias::ConstantBias imuBias;   // bias the preintegration used
+        PipelineLatency::FrameStamps latency;
+    };
+
+    // ingest stage: convert, undistort (incl. photometric correction) and pack the imu batch
+    // while the tracking thread is busy with the previous frame. Returns non-zero to stop.
+    int step(void);
+    void prepareFrame(const sensor_msgs::ImageConstPtr img, PreparedFrame &frame);
+    void undistort(dso::MinimalImageB &minImg, PreparedFrame &frame, int64_t convertStartNs);
+    void subscribe(ros::NodeHandle &nh);
+    void imuCallback(const sensor_msgs::ImuConstPtr &msg);
+    // print_latency service, dumps the stage latencies so far
+    bool printLatency(std_srvs::Empty::Request &request, std_srvs::Empty::Response &response);
+    // live ingest loop
+    void ingestLoop(void);
+
+    // tracking stage, runs on its own thread and consumes the prepared frames
+    void trackingLoop(void);
+    void track(PreparedFrame &frame);
+
+    // arguments
+    std::string _calib;
+    std::string _vignetteFile;
+    std::string _gammaFile;
+    std::string _configFile;
+    std::string _groundTruthFile;
+    std::string _logFile;
+    std::string _bagFile;
+    double _bagOffset;
+    double _bagReadAheadSec;
+    int _pipelineDepth;
+    bool _useSampleOutput;
+
+    dso::FullSystem* _fullSystem;
+    dso::Undistort* _undistorter;
+    UndistortPool* _undistortPool;
+    ConfigParam* _config;
+    GroundTruthCache* _groundTruth;     // null without ground truth
+    MsgSynchronizer* _msgsync;
+    BagReplayer* _bagReplayer;
+    BiasEstimator* _biasEstimator;
+    PosePropagator* _posePropagator;    // live input only
+    TimeOffsetEstimator* _timeOffsetEstimator;  // null if disabled
+    TrackedFrameWrapper* _trackedFrames;    // owned by _fullSystem's output wrappers
+    LogWriter* _log;
+    Evaluator* _evaluator;                  // null without ground truth
+
+    ros::Subscriber _imgSub;
+    ros::Subscriber _imuSub;
+    ros::Publisher _odomPub;
+    ros::ServiceServer _latencyService;
+
+    PipelineLatency _latency;   // off unless latency=1
+    BoundedQueue<PreparedFrame>* _frameQueue;
+    std::thread _ingestThread;
+    std::thread _trackingThread;
+    std::atomic<bool> _stopIngest;
+    bool _running;
+
+    // ingest stage state
+    PreparedFrame _preparedFrame;
+    sensor_msgs::ImageConstPtr _imageMsg;
+    ImuMsgSpan _vimuMsg;
+    double _previousImageTimestamp;
+    ImuBatch _imuBatch;
+    ImuPreintegrator* _imuPreintegrator;   // created in init(), after the noise parameters are set
+    // frames seen by the ingest stage and how many of them needed an image copy
+    int _imageCnt;
+    int _imageCopyCnt;
+    AllocStats _ingestAllocStats;
+
+    // tracking stage state
+    int _frameID;
+    double _previousTrackedTimestamp;
+    uint64_t _biasVersion;  // bias estimate FullSystem has
+    AllocStats _trackAllocStats;
+    uint64_t _dsoAllocCnt;  // allocations inside addActiveFrame in the current frame
+    bool _frameTracked;     // DSO tracked the current frame
+    int64_t _trackEndNs;    // addActiveFrame returned, latency measurement only
+};
+
+}
+
+#endif // DSOLIVE_H
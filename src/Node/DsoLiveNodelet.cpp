@@ -0,0 +1,49 @@
+#include <nodelet/nodelet.h>
+#include <pluginlib/class_list_macros.h>
+
+#include <sstream>
+
+#include "Node/DsoLive.h"
+
+namespace dso_vi
+{
+// dso_live as a nodelet. Loaded into the camera driver's manager it gets the
+// ImageConstPtr of the driver without serialization.
+// The dso_live command line arguments are given as the private parameter "args",
+// e.g. "calib=... gamma=... vignette=... config=... groundtruth=..."
+class DsoLiveNodelet : public nodelet::Nodelet
+{
+public:
+    DsoLiveNodelet() {}
+    ~DsoLiveNodelet()
+    {
+        _dsoLive.shutdown();
+    }
+
+private:
+    virtual void onInit()
+    {
+        std::string args;
+        getPrivateNodeHandle().getParam("args", args);
+
+        std::istringstream argStream(args);
+        std::string arg;
+        while(argStream >> arg)
+            _dsoLive.parseArgument(arg.c_str());
+
+        if(!_dsoLive.init())
+        {
+            NODELET_ERROR("dso_live initialization failed, check the args parameter");
+            return;
+        }
+
+        // the multi threaded handle lets image and imu callbacks run in parallel
+        _dsoLive.startLive(getMTNodeHandle());
+    }
+
+    DsoLive _dsoLive;
+};
+
+}
+
+PLUGINLIB_EXPORT_CLASS(dso_vi::DsoLiveNodelet, nodelet::Nodelet)
@@ -0,0 +1,44 @@
+#ifndef TRACKEDFRAMEWRAPPER_H
+#define TRACKEDFRAMEWRAPPER_H
+
+#include "IOWrapper/Output3DWrapper.h"
+#include "util/FrameShell.h"
+
+namespace dso_vi
+{
+// Remembers the last two frames DSO tracked, so the tracking stage gets them
+// without copying FullSystem's frame history every frame.
+// publishCamPose() is called from addActiveFrame, on the tracking thread.
+class TrackedFrameWrapper : public dso::IOWrap::Output3DWrapper
+{
+public:
+    TrackedFrameWrapper(): _current(0), _previous(0), _frameCnt(0) {}
+
+    virtual void publishCamPose(dso::FrameShell* frame, dso::CalibHessian* HCalib)
+    {
+        _previous = _current;
+        _current = frame;
+        _frameCnt++;
+    }
+
+    virtual void reset()
+    {
+        _current = 0;
+        _previous = 0;
+        _frameCnt = 0;
+    }
+
+    dso::FrameShell* getCurrent(void) const {return _current;}
+    dso::FrameShell* getPrevious(void) const {return _previous;}
+    // tracked frames since the start or the last reset
+    int getFrameCnt(void) const {return _frameCnt;}
+
+private:
+    dso::FrameShell* _current;
+    dso::FrameShell* _previous;
+    int _frameCnt;
+};
+
+}
+
+#endif // TRACKEDFRAMEWRAPPER_H
@@ -0,0 +1,137 @@
+#include "BiasEstimator.h"
+
+#include <cmath>
+
+#include <Eigen/Cholesky>
+
+#include <ros/ros.h>
+
+namespace dso_vi
+{
+
+namespace
+{
+// intervals that need more correction than this are tracking failures, not bias
+const double maxResidualRad = 0.05;
+// intervals needed before the estimate is published
+const size_t minIntervals = 10;
+const int gaussNewtonIterations = 3;
+}
+
+BiasEstimator::BiasEstimator(const gtsam::imuBias::ConstantBias &initialBias, size_t windowSize,
+                             double priorSigmaGyro, double rotationSigma):
+    _windowSize(windowSize), _priorSigmaGyro(priorSigmaGyro), _rotationSigma(rotationSigma),
+    _initialBias(initialBias),
+    _window(windowSize), _windowChanged(false), _shutdown(false), _bias(initialBias), _version(0)
+{
+    _thread = std::thread(&BiasEstimator::run, this);
+}
+
+BiasEstimator::~BiasEstimator()
+{
+    shutdown();
+}
+
+void BiasEstimator::addInterval(const gtsam::Rot3 &imuDeltaR, const Eigen::Matrix3d &delRdelBiasOmega,
+                                const Eigen::Vector3d &biasHatOmega, const gtsam::Rot3 &visualDeltaR)
+{
+    Interval interval;
+    interval.imuDeltaR = imuDeltaR;
+    interval.delRdelBiasOmega = delRdelBiasOmega;
+    interval.biasHatOmega = biasHatOmega;
+    interval.visualDeltaR = visualDeltaR;
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _window.push_back(interval);
+        _windowChanged = true;
+    }
+    _cond.notify_one();
+}
+
+gtsam::imuBias::ConstantBias BiasEstimator::getBias(void) const
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+    return _bias;
+}
+
+void BiasEstimator::shutdown(void)
+{
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _shutdown = true;
+    }
+    _cond.notify_one();
+    if(_thread.joinable())
+        _thread.join();
+}
+
+void BiasEstimator::run(void)
+{
+    std::vector<Interval> window;
+    window.reserve(_windowSize);
+    while(true)
+    {
+        Eigen::Vector3d gyroBias;
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _cond.wait(lock, [this]{return _shutdown || _windowChanged;});
+            if(_shutdown)
+                return;
+            _windowChanged = false;
+            // solve on a copy, the tracker keeps adding intervals meanwhile
+            window.assign(_window.begin(), _window.end());
+            gyroBias = _bias.gyroscope();
+        }
+
+        if(!solve(window, gyroBias))
+            continue;
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _bias = gtsam::imuBias::ConstantBias(_initialBias.accelerometer(), gyroBias);
+        }
+        _version.fetch_add(1, std::memory_order_release);
+        ROS_DEBUG("gyro bias %f %f %f", gyroBias.x(), gyroBias.y(), gyroBias.z());
+    }
+}
+
+bool BiasEstimator::solve(const std::vector<Interval> &window, Eigen::Vector3d &gyroBias) const
+{
+    if(window.size() < minIntervals)
+        return false;
+
+    // residual of an interval for bias b, to first order in the bias change:
+    //   r = Log( (dR_imu * Exp(J * (b - b_hat)))^T * dR_visual )
+    // and dr/db ~= -J
+    const Eigen::Vector3d priorBias = _initialBias.gyroscope();
+    const double priorWeight = 1.0 / (_priorSigmaGyro * _priorSigmaGyro);
+    const double rotationWeight = 1.0 / (_rotationSigma * _rotationSigma);
+    for(int iter = 0; iter < gaussNewtonIterations; iter++)
+    {
+        Eigen::Matrix3d H = priorWeight * Eigen::Matrix3d::Identity();
+        Eigen::Vector3d g = priorWeight * (priorBias - gyroBias);
+        size_t inliers = 0;
+        for(const Interval &interval : window)
+        {
+            const gtsam::Rot3 corrected = interval.imuDeltaR *
+                    gtsam::Rot3::Expmap(interval.delRdelBiasOmega * (gyroBias - interval.biasHatOmega));
+            const Eigen::Vector3d r = gtsam::Rot3::Logmap(corrected.between(interval.visualDeltaR));
+            if(r.norm() > maxResidualRad)
+                continue;
+            H += rotationWeight * interval.delRdelBiasOmega.transpose() * interval.delRdelBiasOmega;
+            g += rotationWeight * interval.delRdelBiasOmega.transpose() * r;
+            inliers++;
+        }
+        if(inliers < minIntervals)
+            return false;
+
+        const Eigen::Vector3d step = H.ldlt().solve(g);
+        gyroBias += step;
+        if(step.norm() < 1e-7)
+            break;
+    }
+    return true;
+}
+
+}
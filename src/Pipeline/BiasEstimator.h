@@ -0,0 +1,77 @@
+#ifndef BIASESTIMATOR_H
+#define BIASESTIMATOR_H
+
+#include <vector>
+#include <mutex>
+#include <thread>
+#include <condition_variable>
+#include <atomic>
+
+#include <Eigen/Core>
+
+#include <boost/circular_buffer.hpp>
+
+#include <gtsam/geometry/Rot3.h>
+#include <gtsam/navigation/ImuBias.h>
+
+namespace dso_vi
+{
+// Keeps the gyro bias current from the tracked frames, on a background thread.
+// Every interval gives the preintegrated imu rotation (with its bias jacobian) and
+// the rotation DSO tracked. Over a sliding window of intervals, the bias that makes
+// the two agree is solved by Gauss-Newton, with a prior on the configured bias.
+// Rotations don't depend on the unknown monocular scale, accelerations do, so the
+// accelerometer bias stays at its configured value.
+class BiasEstimator
+{
+public:
+    // priorSigmaGyro: rad/s, how far the estimate may move away from initialBias
+    // rotationSigma: rad, noise of the rotation DSO tracked between two frames
+    BiasEstimator(const gtsam::imuBias::ConstantBias &initialBias, size_t windowSize = 50,
+                  double priorSigmaGyro = 0.05, double rotationSigma = 0.002);
+    ~BiasEstimator();
+
+    // tracking thread. Both rotations are in the body frame, from the previous image to this one.
+    // delRdelBiasOmega and biasHatOmega are what the preintegration used
+    void addInterval(const gtsam::Rot3 &imuDeltaR, const Eigen::Matrix3d &delRdelBiasOmega,
+                     const Eigen::Vector3d &biasHatOmega, const gtsam::Rot3 &visualDeltaR);
+
+    // latest estimate, any thread
+    gtsam::imuBias::ConstantBias getBias(void) const;
+    // incremented with every new estimate
+    uint64_t getVersion(void) const {return _version.load(std::memory_order_acquire);}
+
+    void shutdown(void);
+
+private:
+    struct Interval
+    {
+        gtsam::Rot3 imuDeltaR;
+        Eigen::Matrix3d delRdelBiasOmega;
+        Eigen::Vector3d biasHatOmega;
+        gtsam::Rot3 visualDeltaR;
+    };
+
+    void run(void);
+    // returns false if too few intervals agree with the imu to trust the window
+    bool solve(const std::vector<Interval> &window, Eigen::Vector3d &gyroBias) const;
+
+    const size_t _windowSize;
+    const double _priorSigmaGyro;
+    const double _rotationSigma;
+    const gtsam::imuBias::ConstantBias _initialBias;
+
+    mutable std::mutex _mutex;
+    std::condition_variable _cond;
+    boost::circular_buffer<Interval> _window;     // drops the oldest interval when full
+    bool _windowChanged;
+    bool _shutdown;
+    gtsam::imuBias::ConstantBias _bias;
+    std::atomic<uint64_t> _version;
+
+    std::thread _thread;
+};
+
+}
+
+#endif // BIASESTIMATOR_H
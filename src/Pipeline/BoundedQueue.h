@@ -0,0 +1,83 @@
+#ifndef BOUNDEDQUEUE_H
+#define BOUNDEDQUEUE_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+#include <cstddef>
+
+namespace dso_vi
+{
+// Blocking fixed capacity FIFO between two pipeline stages.
+// push() blocks while the queue is full, which throttles the producer to the consumer's speed.
+// Storage is preallocated. Items are swapped in and out, so the caller gets the
+// recycled slot back and buffers inside T keep their capacity.
+template<typename T>
+class BoundedQueue
+{
+public:
+    explicit BoundedQueue(size_t capacity):
+        _buffer(capacity > 0 ? capacity : 1), _head(0), _size(0), _closed(false)
+    {
+    }
+
+    // returns false if the queue was closed
+    bool push(T &item)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condNotFull.wait(lock, [this]{return _closed || _size < _buffer.size();});
+        if(_closed)
+            return false;
+        std::swap(_buffer[(_head + _size) % _buffer.size()], item);
+        _size++;
+        lock.unlock();
+        _condNotEmpty.notify_one();
+        return true;
+    }
+
+    // returns false once the queue is closed and empty
+    bool pop(T &item)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _condNotEmpty.wait(lock, [this]{return _closed || _size > 0;});
+        if(_size == 0)
+            return false;
+        std::swap(item, _buffer[_head]);
+        _head = (_head + 1) % _buffer.size();
+        _size--;
+        lock.unlock();
+        _condNotFull.notify_one();
+        return true;
+    }
+
+    // wake everybody, pending items can still be popped
+    void close(void)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _condNotFull.notify_all();
+        _condNotEmpty.notify_all();
+    }
+
+    size_t size(void)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _size;
+    }
+    size_t capacity(void) const {return _buffer.size();}
+
+private:
+    std::vector<T> _buffer;
+    size_t _head;
+    size_t _size;
+    bool _closed;
+    std::mutex _mutex;
+    std::condition_variable _condNotFull;
+    std::condition_variable _condNotEmpty;
+};
+
+}
+
+#endif // BOUNDEDQUEUE_H
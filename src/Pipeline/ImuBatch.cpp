@@ -0,0 +1,56 @@
+#include "ImuBatch.h"
+
+#include <algorithm>
+
+namespace dso_vi
+{
+
+void ImuBatch::reserve(size_t n)
+{
+    if((size_t)_t.rows() >= n)
+        return;
+    const size_t capacity = std::max<size_t>(n, 2*_t.rows());
+    _t.resize(capacity);
+    _gyro.resize(capacity, 3);
+    _acc.resize(capacity, 3);
+}
+
+void ImuBatch::fill(const ImuMsgSpan &span, double accMultiplier)
+{
+    const size_t n = span.size() + (span.hasFront ? 2 : 1);
+    reserve(n);
+    _size = n;
+
+    // gather, the messages are scattered on the heap
+    double *t = _t.data();
+    double *gx = _gyro.col(0).data(), *gy = _gyro.col(1).data(), *gz = _gyro.col(2).data();
+    double *ax = _acc.col(0).data(), *ay = _acc.col(1).data(), *az = _acc.col(2).data();
+    size_t k = 0;
+    if(span.hasFront)
+        setRow(k++, span.front.stampNs, span.front.angular_velocity, span.front.linear_acceleration);
+    for(size_t i = 0; i < span.size(); i++, k++)
+    {
+        const sensor_msgs::Imu &msg = *span[i];
+        t[k] = span.stampsNs[i] * 1e-9;
+        gx[k] = msg.angular_velocity.x;
+        gy[k] = msg.angular_velocity.y;
+        gz[k] = msg.angular_velocity.z;
+        ax[k] = msg.linear_acceleration.x;
+        ay[k] = msg.linear_acceleration.y;
+        az[k] = msg.linear_acceleration.z;
+    }
+    setRow(k, span.back.stampNs, span.back.angular_velocity, span.back.linear_acceleration);
+
+    // contiguous columns, vectorized by Eigen
+    if(accMultiplier != 1)
+        _acc.topRows(n) *= accMultiplier;
+}
+
+void ImuBatch::setRow(size_t k, int64_t stampNs, const geometry_msgs::Vector3 &gyro, const geometry_msgs::Vector3 &acc)
+{
+    _t(k) = stampNs * 1e-9;
+    _gyro.row(k) << gyro.x, gyro.y, gyro.z;
+    _acc.row(k) << acc.x, acc.y, acc.z;
+}
+
+}
@@ -0,0 +1,44 @@
+#ifndef IMUBATCH_H
+#define IMUBATCH_H
+
+#include <Eigen/Core>
+
+#include "MsgSync/MsgSynchronizer.h"
+
+namespace dso_vi
+{
+// The imu samples of one image interval as structure of arrays, including the
+// interpolated samples at the interval ends. Each of
+// t, gyro.col(k) and acc.col(k) is contiguous, so unit conversions run vectorized.
+// The arrays only grow, a steady stream of batches doesn't allocate.
+class ImuBatch
+{
+public:
+    typedef Eigen::Matrix<double, Eigen::Dynamic, 3> Samples3;
+
+    ImuBatch(): _size(0) {}
+
+    // copy the samples out of the synchronizer's span, accelerations are multiplied by accMultiplier
+    void fill(const ImuMsgSpan &span, double accMultiplier);
+
+    size_t size(void) const {return _size;}
+    bool empty(void) const {return _size == 0;}
+
+    // valid rows are [0, size())
+    const Eigen::VectorXd &t(void) const {return _t;}
+    const Samples3 &gyro(void) const {return _gyro;}
+    const Samples3 &acc(void) const {return _acc;}
+
+private:
+    void reserve(size_t n);
+    void setRow(size_t k, int64_t stampNs, const geometry_msgs::Vector3 &gyro, const geometry_msgs::Vector3 &acc);
+
+    size_t _size;
+    Eigen::VectorXd _t;     // seconds
+    Samples3 _gyro;         // rad/s
+    Samples3 _acc;          // m/s^2 after scaling
+};
+
+}
+
+#endif // IMUBATCH_H
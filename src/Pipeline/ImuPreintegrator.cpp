@@ -0,0 +1,67 @@
+#include "ImuPreintegrator.h"
+#include "IMU/configparam.h"
+#include "IMU/imudata.h"
+
+namespace dso_vi
+{
+
+ImuPreintegrator::ImuPreintegrator():
+    _preintegrated(dso_vi::getIMUParams(), gtsam::imuBias::ConstantBias()),
+    _lastTime(0), _hasLast(false)
+{
+}
+
+void ImuPreintegrator::reset(const gtsam::imuBias::ConstantBias &bias)
+{
+    _preintegrated.resetIntegrationAndSetBias(bias);
+    _hasLast = false;
+}
+
+void ImuPreintegrator::integrate(const Eigen::Vector3d &acc, const Eigen::Vector3d &gyro, double t)
+{
+    // only samples with the same stamp are skipped, they span no time
+    // (and gtsam scales the noise by 1/dt)
+    const double dt = t - _lastTime;
+    if (_hasLast && dt > 0)
+    {
+        _preintegrated.integrateMeasurement(0.5*(acc + _lastAcc), 0.5*(gyro + _lastGyro), dt);
+    }
+    _lastAcc = acc;
+    _lastGyro = gyro;
+    _lastTime = t;
+    _hasLast = true;
+}
+
+void ImuPreintegrator::integrate(const ImuBatch &batch)
+{
+    const size_t n = batch.size();
+    if(n == 0)
+        return;
+
+    // the first row continues from the previous sample, if any
+    const Eigen::VectorXd &tCol = batch.t();
+    const ImuBatch::Samples3 &acc = batch.acc();
+    const ImuBatch::Samples3 &gyro = batch.gyro();
+    integrate(acc.row(0).transpose(), gyro.row(0).transpose(), tCol(0));
+
+    // the rest straight from the columns, the midpoints are the only vectors gtsam gets
+    const double *t = tCol.data();
+    const double *gx = gyro.col(0).data(), *gy = gyro.col(1).data(), *gz = gyro.col(2).data();
+    const double *ax = acc.col(0).data(), *ay = acc.col(1).data(), *az = acc.col(2).data();
+    Eigen::Vector3d accMid, gyroMid;
+    for(size_t i = 1; i < n; i++)
+    {
+        const double dt = t[i] - t[i-1];
+        if(dt <= 0)
+            continue;
+        accMid << 0.5*(ax[i] + ax[i-1]), 0.5*(ay[i] + ay[i-1]), 0.5*(az[i] + az[i-1]);
+        gyroMid << 0.5*(gx[i] + gx[i-1]), 0.5*(gy[i] + gy[i-1]), 0.5*(gz[i] + gz[i-1]);
+        _preintegrated.integrateMeasurement(accMid, gyroMid, dt);
+    }
+
+    _lastAcc << ax[n-1], ay[n-1], az[n-1];
+    _lastGyro << gx[n-1], gy[n-1], gz[n-1];
+    _lastTime = t[n-1];
+}
+
+}
@@ -0,0 +1,45 @@
+#ifndef IMUPREINTEGRATOR_H
+#define IMUPREINTEGRATOR_H
+
+#include <Eigen/Core>
+
+#include <gtsam/navigation/ImuFactor.h>
+
+#include "ImuBatch.h"
+
+namespace dso_vi
+{
+// Preintegration of the imu samples between two images.
+// One instance lives for the whole run and is reset in place for every interval,
+// samples are integrated as the synchronizer hands them out.
+class ImuPreintegrator
+{
+public:
+    ImuPreintegrator();
+
+    // start a new interval, no allocation. The interval starts at the first sample
+    void reset(const gtsam::imuBias::ConstantBias &bias);
+
+    // sample measured at time t. The step from the previous sample is integrated
+    // with the mean of both samples (trapezoidal rule)
+    void integrate(const Eigen::Vector3d &acc, const Eigen::Vector3d &gyro, double t);
+    // all samples of the batch, read straight from its arrays.
+    // The batch starts and ends exactly at the images, so the whole interval is covered
+    void integrate(const ImuBatch &batch);
+
+    // current delta of the interval
+    gtsam::Rot3 deltaRij(void) const {return _preintegrated.deltaRij();}
+    double deltaTij(void) const {return _preintegrated.deltaTij();}
+    const gtsam::PreintegratedImuMeasurements &getPreintegrated(void) const {return _preintegrated;}
+
+private:
+    gtsam::PreintegratedImuMeasurements _preintegrated;
+    Eigen::Vector3d _lastAcc;
+    Eigen::Vector3d _lastGyro;
+    double _lastTime;
+    bool _hasLast;
+};
+
+}
+
+#endif // IMUPREINTEGRATOR_H
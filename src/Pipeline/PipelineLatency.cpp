@@ -0,0 +1,35 @@
+#include "PipelineLatency.h"
+
+namespace dso_vi
+{
+
+PipelineLatency::PipelineLatency():
+    _enabled(false)
+{
+}
+
+const char* PipelineLatency::getStageName(Stage stage)
+{
+    static const char* names[STAGE_CNT] = {
+        "sync", "imu", "convert", "undistort", "frame queue", "track", "post", "total"
+    };
+    return names[stage];
+}
+
+void PipelineLatency::print(FILE* out) const
+{
+    if(!_enabled)
+        return;
+
+    fprintf(out, "latency [ms]      count      mean       p50       p99       max\n");
+    for(int i = 0; i < STAGE_CNT; i++)
+    {
+        const LatencyHistogram &histogram = _histograms[i];
+        fprintf(out, "  %-12s %8lu %9.3f %9.3f %9.3f %9.3f\n", getStageName((Stage)i),
+                (unsigned long)histogram.getCount(), histogram.getMean() * 1e-6,
+                histogram.getPercentile(0.5) * 1e-6, histogram.getPercentile(0.99) * 1e-6,
+                histogram.getMax() * 1e-6);
+    }
+}
+
+}
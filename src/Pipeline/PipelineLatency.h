@@ -0,0 +1,62 @@
+#ifndef PIPELINELATENCY_H
+#define PIPELINELATENCY_H
+
+#include <cstdint>
+#include <cstdio>
+
+#include "Util/LatencyHistogram.h"
+
+namespace dso_vi
+{
+// Latency of each stage a frame goes through, from the image reaching the synchronizer
+// to the end of DsoLive::track(), kept in LatencyHistogram per stage.
+// Off by default; when off the pipeline doesn't read the clock at all.
+class PipelineLatency
+{
+public:
+    enum Stage
+    {
+        SYNC = 0,       // image added to the synchronizer -> handed out by getRecentMsgs
+        IMU,            // imu batch and preintegration in the ingest stage
+        CONVERT,        // cv_bridge conversion, ~0 on the mono8 fast path
+        UNDISTORT,
+        FRAME_QUEUE,    // prepared -> picked up by the tracking thread
+        TRACK,          // FullSystem::addActiveFrame
+        POST,           // rest of track(), estimators and hand off to the evaluator
+        TOTAL,          // image added to the synchronizer -> end of track()
+        STAGE_CNT
+    };
+
+    // stamps in latencyNowNs() time that travel with the frame across threads
+    struct FrameStamps
+    {
+        FrameStamps(): arrivalNs(0), preparedNs(0) {}
+
+        int64_t arrivalNs;      // added to the synchronizer
+        int64_t preparedNs;     // end of the ingest stage
+    };
+
+    PipelineLatency();
+
+    void setEnabled(bool enabled) {_enabled = enabled;}
+    bool isEnabled(void) const {return _enabled;}
+
+    void record(Stage stage, int64_t startNs, int64_t endNs)
+    {
+        _histograms[stage].record(endNs - startNs);
+    }
+
+    // count, mean, p50, p99 and max per stage in ms, any thread
+    void print(FILE* out = stdout) const;
+
+    const LatencyHistogram &getHistogram(Stage stage) const {return _histograms[stage];}
+    static const char* getStageName(Stage stage);
+
+private:
+    bool _enabled;
+    LatencyHistogram _histograms[STAGE_CNT];
+};
+
+}
+
+#endif // PIPELINELATENCY_H
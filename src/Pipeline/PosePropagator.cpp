@@ -0,0 +1,109 @@
+#include "PosePropagator.h"
+
+namespace dso_vi
+{
+
+namespace
+{
+// tracked poses further apart give no usable velocity
+const double maxVelocityGapSec = 0.5;
+}
+
+PosePropagator::PosePropagator(const ros::Publisher &publisher, const std::string &frameId,
+                               const std::string &childFrameId, double historySec):
+    _publisher(publisher), _historySec(historySec),
+    _hasPose(false), _t(0), _p(Eigen::Vector3d::Zero()), _v(Eigen::Vector3d::Zero()),
+    _omega(Eigen::Vector3d::Zero()), _gyroBias(Eigen::Vector3d::Zero()),
+    _visualT(-1), _visualP(Eigen::Vector3d::Zero()), _publishedCnt(0)
+{
+    // set once, the callback only fills in the pose
+    _odom.header.frame_id = frameId;
+    _odom.child_frame_id = childFrameId;
+}
+
+void PosePropagator::addImuMsg(const sensor_msgs::ImuConstPtr &imumsg)
+{
+    ImuSample sample;
+    sample.t = imumsg->header.stamp.toSec();
+    sample.gyro = Eigen::Vector3d(imumsg->angular_velocity.x, imumsg->angular_velocity.y, imumsg->angular_velocity.z);
+
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        _history.push_back(sample);
+        while(_history.front().t < sample.t - _historySec)
+            _history.pop_front();
+
+        if(!propagate(sample))
+            return;
+        fillOdometry(_odom);
+    }
+    _odom.header.stamp = imumsg->header.stamp;
+    _publisher.publish(_odom);
+    _publishedCnt.fetch_add(1, std::memory_order_relaxed);
+}
+
+void PosePropagator::setVisualPose(double t, const gtsam::Pose3 &bodyToWorld, const Eigen::Vector3d &gyroBias)
+{
+    std::lock_guard<std::mutex> lock(_mutex);
+
+    const Eigen::Vector3d p = bodyToWorld.translation();
+    if(_visualT >= 0 && t > _visualT && t - _visualT < maxVelocityGapSec)
+        _v = (p - _visualP) / (t - _visualT);
+    else
+        _v.setZero();
+    _visualT = t;
+    _visualP = p;
+
+    _hasPose = true;
+    _t = t;
+    _R = bodyToWorld.rotation();
+    _p = p;
+    _gyroBias = gyroBias;
+
+    // the rate at the pose is the one of the last sample before it
+    std::deque<ImuSample>::const_iterator it = _history.begin();
+    _omega.setZero();
+    for(; it != _history.end() && it->t <= t; ++it)
+        _omega = it->gyro - _gyroBias;
+
+    // integrate the samples that arrived while the frame was tracked
+    for(; it != _history.end(); ++it)
+        propagate(*it);
+}
+
+bool PosePropagator::propagate(const ImuSample &sample)
+{
+    if(!_hasPose || sample.t <= _t)
+        return false;
+
+    const double dt = sample.t - _t;
+    const Eigen::Vector3d omega = sample.gyro - _gyroBias;
+    _R = _R * gtsam::Rot3::Expmap(0.5 * (omega + _omega) * dt);
+    _p += _v * dt;
+    _omega = omega;
+    _t = sample.t;
+    return true;
+}
+
+void PosePropagator::fillOdometry(nav_msgs::Odometry &odom) const
+{
+    const gtsam::Quaternion q = _R.toQuaternion();
+    odom.pose.pose.position.x = _p.x();
+    odom.pose.pose.position.y = _p.y();
+    odom.pose.pose.position.z = _p.z();
+    odom.pose.pose.orientation.x = q.x();
+    odom.pose.pose.orientation.y = q.y();
+    odom.pose.pose.orientation.z = q.z();
+    odom.pose.pose.orientation.w = q.w();
+
+    // twist is in the child frame
+    const Eigen::Vector3d v = _R.unrotate(_v);
+    odom.twist.twist.linear.x = v.x();
+    odom.twist.twist.linear.y = v.y();
+    odom.twist.twist.linear.z = v.z();
+    odom.twist.twist.angular.x = _omega.x();
+    odom.twist.twist.angular.y = _omega.y();
+    odom.twist.twist.angular.z = _omega.z();
+}
+
+}
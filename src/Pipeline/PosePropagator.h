@@ -0,0 +1,80 @@
+#ifndef POSEPROPAGATOR_H
+#define POSEPROPAGATOR_H
+
+#include <deque>
+#include <atomic>
+#include <mutex>
+#include <string>
+
+#include <Eigen/Core>
+
+#include <ros/ros.h>
+#include <sensor_msgs/Imu.h>
+#include <nav_msgs/Odometry.h>
+
+#include <gtsam/geometry/Pose3.h>
+
+namespace dso_vi
+{
+// Publishes the body pose at imu rate between the camera frames.
+// Starting from the latest pose tracked by DSO, the rotation is propagated with the
+// bias corrected gyro and the position with the velocity of the last two tracked poses
+// (monocular DSO has no metric scale to integrate accelerations in).
+// Each imu message is integrated and published right in its callback, so the
+// latency is one callback. When a new tracked pose lands, the imu samples since its
+// timestamp are integrated again from it.
+class PosePropagator
+{
+public:
+    // historySec: how long the imu samples are kept for re-propagation
+    PosePropagator(const ros::Publisher &publisher, const std::string &frameId,
+                   const std::string &childFrameId, double historySec = 1.0);
+
+    // imu callback thread
+    void addImuMsg(const sensor_msgs::ImuConstPtr &imumsg);
+
+    // tracking thread. t in imu time, bodyToWorld is the tracked body pose in the DSO world frame
+    void setVisualPose(double t, const gtsam::Pose3 &bodyToWorld, const Eigen::Vector3d &gyroBias);
+
+    uint64_t getPublishedCnt(void) const {return _publishedCnt.load(std::memory_order_relaxed);}
+
+private:
+    struct ImuSample
+    {
+        double t;
+        Eigen::Vector3d gyro;
+    };
+
+    // integrate one sample into the state, false if it is not after the state
+    bool propagate(const ImuSample &sample);
+    // pose and twist, the frame ids are set once
+    void fillOdometry(nav_msgs::Odometry &odom) const;
+
+    ros::Publisher _publisher;
+    const double _historySec;
+
+    std::mutex _mutex;
+    std::deque<ImuSample> _history;
+
+    // propagated state
+    bool _hasPose;
+    double _t;
+    gtsam::Rot3 _R;             // body to world
+    Eigen::Vector3d _p;         // body position in world
+    Eigen::Vector3d _v;         // world frame, from the last two tracked poses
+    Eigen::Vector3d _omega;     // bias corrected rate of the last integrated sample, body frame
+    Eigen::Vector3d _gyroBias;
+
+    // last tracked pose, for the velocity
+    double _visualT;
+    Eigen::Vector3d _visualP;
+
+    // reused for every message, only touched by the imu callback
+    nav_msgs::Odometry _odom;
+
+    std::atomic<uint64_t> _publishedCnt;
+};
+
+}
+
+#endif // POSEPROPAGATOR_H
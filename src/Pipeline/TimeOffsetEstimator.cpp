@@ -0,0 +1,148 @@
+#include "TimeOffsetEstimator.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace dso_vi
+{
+
+namespace
+{
+// below this the match is noise
+const double minCorrelation = 0.8;
+// total visual rotation in the window needed to trust it, rad
+const double minRotationRad = 1.0;
+const size_t minFrames = 50;
+}
+
+TimeOffsetEstimator::TimeOffsetEstimator(double initialDelaySec, double searchRangeSec,
+                                         double stepSec, double windowSec):
+    _initialDelaySec(initialDelaySec), _searchRangeSec(searchRangeSec),
+    _stepSec(stepSec), _windowSec(windowSec),
+    _steps((int)std::round(searchRangeSec / stepSec)),
+    _gyro(4096), _visual(512), _residuals(2*_steps + 1)
+{
+}
+
+void TimeOffsetEstimator::addGyro(double t, const Eigen::Vector3d &gyro)
+{
+    GyroSample sample;
+    sample.t = t;
+    sample.gyro = gyro;
+    if(_gyro.empty())
+        sample.integral.setZero();
+    else
+    {
+        const GyroSample &last = _gyro.back();
+        if(t <= last.t)
+            return;
+        sample.integral = last.integral + 0.5 * (last.gyro + gyro) * (t - last.t);
+    }
+    // keep enough for the window shifted by the search range
+    while(!_gyro.empty() && _gyro.front().t < t - _windowSec - 2*_searchRangeSec)
+        _gyro.pop_front();
+    if(_gyro.full())
+        _gyro.set_capacity(2 * _gyro.capacity());
+    _gyro.push_back(sample);
+}
+
+void TimeOffsetEstimator::addVisualRotation(double tPrev, double t, const Eigen::Vector3d &rotation)
+{
+    VisualRotation visual;
+    visual.tPrev = tPrev;
+    visual.t = t;
+    visual.rotation = rotation;
+    while(!_visual.empty() && _visual.front().tPrev < t - _windowSec)
+        _visual.pop_front();
+    if(_visual.full())
+        _visual.set_capacity(2 * _visual.capacity());
+    _visual.push_back(visual);
+}
+
+bool TimeOffsetEstimator::gyroIntegral(double t, Eigen::Vector3d &integral) const
+{
+    if(_gyro.empty() || t < _gyro.front().t || t > _gyro.back().t)
+        return false;
+
+    boost::circular_buffer<GyroSample>::const_iterator it = std::lower_bound(_gyro.begin(), _gyro.end(), t,
+            [](const GyroSample &sample, double t) {return sample.t < t;});
+    if(it->t == t)
+    {
+        integral = it->integral;
+        return true;
+    }
+    const GyroSample &before = *(it - 1);
+    const double dt = t - before.t;
+    // the rate is linear between the samples
+    const Eigen::Vector3d gyro = before.gyro + (it->gyro - before.gyro) * (dt / (it->t - before.t));
+    integral = before.integral + 0.5 * (before.gyro + gyro) * dt;
+    return true;
+}
+
+bool TimeOffsetEstimator::compare(double delaySec, double &residual, double &correlation) const
+{
+    const double minDelay = _initialDelaySec - _searchRangeSec;
+    const double maxDelay = _initialDelaySec + _searchRangeSec;
+    double dot = 0, visualNorm = 0, gyroNorm = 0;
+    residual = 0;
+    for(const VisualRotation &visual : _visual)
+    {
+        // same intervals for every candidate: only those covered by the gyro at both ends of the range
+        if(visual.tPrev - maxDelay < _gyro.front().t || visual.t - minDelay > _gyro.back().t)
+            continue;
+        Eigen::Vector3d from, to;
+        if(!gyroIntegral(visual.tPrev - delaySec, from) || !gyroIntegral(visual.t - delaySec, to))
+            return false;
+        const Eigen::Vector3d gyroRotation = to - from;
+        residual += (visual.rotation - gyroRotation).squaredNorm();
+        dot += visual.rotation.dot(gyroRotation);
+        visualNorm += visual.rotation.squaredNorm();
+        gyroNorm += gyroRotation.squaredNorm();
+    }
+    if(visualNorm <= 0 || gyroNorm <= 0)
+        return false;
+    correlation = dot / std::sqrt(visualNorm * gyroNorm);
+    return true;
+}
+
+bool TimeOffsetEstimator::estimate(double &delaySec) const
+{
+    if(_visual.size() < minFrames || _gyro.empty())
+        return false;
+
+    double rotation = 0;
+    for(const VisualRotation &visual : _visual)
+        rotation += visual.rotation.norm();
+    if(rotation < minRotationRad)
+        return false;
+
+    // both are rotations in rad, the best delay is the one with the smallest difference
+    const int steps = _steps;
+    std::vector<double> &residuals = _residuals;
+    int best = -1;
+    double bestCorrelation = 0;
+    for(int i = 0; i <= 2*steps; i++)
+    {
+        double correlation;
+        if(!compare(_initialDelaySec + (i - steps) * _stepSec, residuals[i], correlation))
+            return false;
+        if(best < 0 || residuals[i] < residuals[best])
+        {
+            best = i;
+            bestCorrelation = correlation;
+        }
+    }
+
+    // a minimum on the border of the search range is not a minimum
+    if(bestCorrelation < minCorrelation || best == 0 || best == 2*steps)
+        return false;
+
+    // sub-step refinement, parabola through the minimum and its neighbours
+    const double left = residuals[best - 1], center = residuals[best], right = residuals[best + 1];
+    const double denom = left - 2*center + right;
+    const double offset = denom > 0 ? 0.5 * (left - right) / denom : 0;
+    delaySec = _initialDelaySec + (best - steps + offset) * _stepSec;
+    return true;
+}
+
+}
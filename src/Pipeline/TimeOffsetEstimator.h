@@ -0,0 +1,65 @@
+#ifndef TIMEOFFSETESTIMATOR_H
+#define TIMEOFFSETESTIMATOR_H
+
+#include <vector>
+
+#include <Eigen/Core>
+
+#include <boost/circular_buffer.hpp>
+
+namespace dso_vi
+{
+// Estimates the image delay to the imu (imu time = image time - delay) by matching
+// the rotations DSO tracked between frames with the gyro integrated over the same
+// intervals, shifted by candidate delays around the configured one.
+// Needs rotation to lock on, without excitation estimate() keeps returning false.
+class TimeOffsetEstimator
+{
+public:
+    // delays in [initialDelaySec - searchRangeSec, initialDelaySec + searchRangeSec] are searched
+    TimeOffsetEstimator(double initialDelaySec, double searchRangeSec = 0.03,
+                        double stepSec = 0.0005, double windowSec = 10.0);
+
+    // imu time, bias corrected. Samples not after the previous one are ignored
+    void addGyro(double t, const Eigen::Vector3d &gyro);
+    // image time, rotation vector (Log) in the body frame from tPrev to t
+    void addVisualRotation(double tPrev, double t, const Eigen::Vector3d &rotation);
+
+    // true and the delay if the window gives a confident one
+    bool estimate(double &delaySec) const;
+
+private:
+    struct GyroSample
+    {
+        double t;
+        Eigen::Vector3d gyro;
+        Eigen::Vector3d integral;   // of gyro since the first sample ever
+    };
+    struct VisualRotation
+    {
+        double tPrev;
+        double t;
+        Eigen::Vector3d rotation;
+    };
+
+    // integral of the gyro up to t, false if t is outside the buffered samples
+    bool gyroIntegral(double t, Eigen::Vector3d &integral) const;
+    // squared difference and normalized correlation of the visual rotations and the gyro delayed by delaySec
+    bool compare(double delaySec, double &residual, double &correlation) const;
+
+    const double _initialDelaySec;
+    const double _searchRangeSec;
+    const double _stepSec;
+    const double _windowSec;
+    const int _steps;           // candidate delays on each side of the initial one
+
+    // grow if the window doesn't fit, no allocation in steady state
+    boost::circular_buffer<GyroSample> _gyro;
+    boost::circular_buffer<VisualRotation> _visual;
+    // residual per candidate delay, sized once so estimate() doesn't allocate
+    mutable std::vector<double> _residuals;
+};
+
+}
+
+#endif // TIMEOFFSETESTIMATOR_H
@@ -0,0 +1,158 @@
+#include "UndistortPool.h"
+#include "util/settings.h"
+
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdlib>
+
+namespace dso_vi
+{
+
+namespace
+{
+// Undistort keeps its passthrough flag and remap table protected, member pointers
+// taken in a derived class read them
+struct UndistortAccess : public dso::Undistort
+{
+    static bool isPassthrough(const dso::Undistort* undistorter)
+    {
+        return undistorter->*(&UndistortAccess::passthrough);
+    }
+    static float* getRemapX(dso::Undistort* undistorter)
+    {
+        return undistorter->*(&UndistortAccess::remapX);
+    }
+    static float* getRemapY(dso::Undistort* undistorter)
+    {
+        return undistorter->*(&UndistortAccess::remapY);
+    }
+};
+}
+
+UndistortPool::UndistortPool(dso::Undistort* undistorter, int poolSize):
+    _undistorter(undistorter), _remapX(0), _remapY(0)
+{
+    _w = undistorter->getSize()[0];
+    _h = undistorter->getSize()[1];
+    _wOrg = undistorter->getOriginalSize()[0];
+    _hOrg = undistorter->getOriginalSize()[1];
+    _passthrough = UndistortAccess::isPassthrough(undistorter);
+
+    for(int i=0;i<poolSize;i++)
+        _images.push_back(new dso::ImageAndExposure(_w, _h));
+    _freeImages = _images;
+
+    if(_passthrough)
+        return;
+
+    float* remapX = UndistortAccess::getRemapX(undistorter);
+    float* remapY = UndistortAccess::getRemapY(undistorter);
+
+    // Undistort bounds the source row by wOrg-1 instead of hOrg-1 (and clamps x where it means y),
+    // so with a landscape image the last row is kept and the interpolation reads the row below it,
+    // past the end of the image. Mark those pixels as outside, for Undistort::undistort too.
+    for(int idx=0;idx<_w*_h;idx++)
+    {
+        if(remapX[idx] >= 0 && remapY[idx] >= _hOrg-1)
+        {
+            remapX[idx] = -1;
+            remapY[idx] = -1;
+        }
+    }
+
+    _remapX = remapX;
+    _remapY = remapY;
+}
+
+UndistortPool::~UndistortPool()
+{
+    for(dso::ImageAndExposure* img : _images)
+        delete img;
+}
+
+dso::ImageAndExposure* UndistortPool::undistort(const dso::MinimalImageB* image_raw, float exposure, double timestamp, float factor)
+{
+    // the benchmark noise options are only implemented by Undistort
+    if(_undistorter->photometricUndist == 0 || dso::benchmark_varNoise > 0 || dso::benchmark_varBlurNoise > 0)
+        return _undistorter->undistort<unsigned char>(image_raw, exposure, timestamp, factor);
+
+    if(image_raw->w != _wOrg || image_raw->h != _hOrg)
+    {
+        printf("UndistortPool::undistort: wrong image size (%d %d instead of %d %d) \n", image_raw->w, image_raw->h, _wOrg, _hOrg);
+        exit(1);
+    }
+
+    dso::ImageAndExposure* result;
+    {
+        std::unique_lock<std::mutex> lock(_mutexFree);
+        _condFree.wait(lock, [this]{return !_freeImages.empty();});
+        result = _freeImages.back();
+        _freeImages.pop_back();
+    }
+
+    _undistorter->photometricUndist->processFrame<unsigned char>(image_raw->data, exposure, factor);
+    result->timestamp = timestamp;
+    _undistorter->photometricUndist->output->copyMetaTo(*result);
+
+    float* out_data = result->image;
+    const float* in_data = _undistorter->photometricUndist->output->image;
+    if(_passthrough)
+    {
+        memcpy(out_data, in_data, sizeof(float)*_w*_h);
+        return result;
+    }
+
+    // Undistort::undistort's interpolation, into the pooled buffer
+    const float* remapX = _remapX;
+    const float* remapY = _remapY;
+    for(int idx = _w*_h-1;idx>=0;idx--)
+    {
+        // get interp. values
+        float xx = remapX[idx];
+        float yy = remapY[idx];
+
+        if(xx<0)
+            out_data[idx] = 0;
+        else
+        {
+            // get integer and rational parts
+            int xxi = xx;
+            int yyi = yy;
+            xx -= xxi;
+            yy -= yyi;
+            float xxyy = xx*yy;
+
+            // get array base pointer
+            const float* src = in_data + xxi + yyi * _wOrg;
+
+            // interpolate (bilinear)
+            out_data[idx] =  xxyy * src[1+_wOrg]
+                                + (yy-xxyy) * src[_wOrg]
+                                + (xx-xxyy) * src[1]
+                                + (1-xx-yy+xxyy) * src[0];
+        }
+    }
+
+    return result;
+}
+
+void UndistortPool::release(dso::ImageAndExposure* img)
+{
+    if(img == 0)
+        return;
+
+    if(std::find(_images.begin(), _images.end(), img) == _images.end())
+    {
+        delete img;
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(_mutexFree);
+        _freeImages.push_back(img);
+    }
+    _condFree.notify_one();
+}
+
+}
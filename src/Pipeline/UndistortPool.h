@@ -0,0 +1,48 @@
+#ifndef UNDISTORTPOOL_H
+#define UNDISTORTPOOL_H
+
+#include <vector>
+#include <mutex>
+#include <condition_variable>
+
+#include "util/Undistort.h"
+#include "util/ImageAndExposure.h"
+#include "util/MinimalImage.h"
+
+namespace dso_vi
+{
+// Undistortion into a fixed set of preallocated ImageAndExposure buffers.
+// Interpolates with the remap table of the Undistort it is given (a passthrough calibration
+// is a plain copy), but the result comes from the pool instead of the heap
+// and has to be handed back with release(). Not reentrant, like Undistort itself.
+// The constructor fixes the bounds of that table, see UndistortPool.cpp.
+class UndistortPool
+{
+public:
+    UndistortPool(dso::Undistort* undistorter, int poolSize);
+    ~UndistortPool();
+
+    // photometric correction and undistortion, blocks while all buffers are in use
+    dso::ImageAndExposure* undistort(const dso::MinimalImageB* image_raw, float exposure = 0, double timestamp = 0, float factor = 1);
+
+    // thread safe, also accepts images that were not taken from the pool
+    void release(dso::ImageAndExposure* img);
+
+private:
+    dso::Undistort* _undistorter;
+    int _w, _h, _wOrg, _hOrg;
+    bool _passthrough;      // output calibration "none", no remap
+
+    // Undistort's table: source coordinates of each output pixel, -1 if outside of the original image
+    const float* _remapX;
+    const float* _remapY;
+
+    std::vector<dso::ImageAndExposure*> _images;
+    std::mutex _mutexFree;
+    std::condition_variable _condFree;
+    std::vector<dso::ImageAndExposure*> _freeImages;
+};
+
+}
+
+#endif // UNDISTORTPOOL_H
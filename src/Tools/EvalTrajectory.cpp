@@ -0,0 +1,59 @@
+// Evaluates a dso_live run log against the EuRoC ground truth: ATE after Sim(3) alignment,
+// RPE, drift per distance and the relative rotation errors of DSO and the imu.
+// The log is streamed record by record, the ground truth goes through GroundTruthCache
+// (its .bin cache is reused between runs). The config gives the camera to body transform.
+//
+// usage: dso_eval <log> <groundtruth csv> <config yaml> [summary json] [rpe delta in s, default 1]
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "IMU/configparam.h"
+#include "Eval/GroundTruthCache.h"
+#include "Eval/TrajectoryMetrics.h"
+#include "Log/LogReader.h"
+
+using namespace dso_vi;
+
+int main(int argc, char** argv)
+{
+    if(argc < 4)
+    {
+        printf("usage: dso_eval <log> <groundtruth csv> <config yaml> [summary json] [rpe delta in s]\n");
+        return 1;
+    }
+    const double rpeDeltaSec = argc > 5 ? atof(argv[5]) : 1.0;
+
+    LogReader reader(argv[1]);
+    GroundTruthCache groundTruth(argv[2]);
+    if(!reader.isValid() || !groundTruth.isValid())
+        return 1;
+
+    ConfigParam config(argv[3]);
+    const Eigen::Matrix4d Tbc = config.GetEigTbc();
+    const gtsam::Pose3 bodyToCamera(gtsam::Rot3(Eigen::Matrix3d(Tbc.block<3,3>(0,0))), gtsam::Point3(Tbc.block<3,1>(0,3)));
+
+    TrajectoryMetrics metrics;
+    const unsigned long gapCnt = metrics.addLog(reader, groundTruth, bodyToCamera);
+    if(gapCnt > 0)
+        printf("%lu poses without ground truth skipped\n", gapCnt);
+
+    TrajectoryMetrics::Summary summary;
+    if(!metrics.compute(summary, rpeDeltaSec))
+        printf("too few poses to align, only rotation errors\n");
+    TrajectoryMetrics::print(stdout, summary);
+
+    if(argc > 4)
+    {
+        FILE* out = fopen(argv[4], "w");
+        if(!out)
+        {
+            printf("could not create %s\n", argv[4]);
+            return 1;
+        }
+        TrajectoryMetrics::writeJson(out, summary);
+        fprintf(out, "\n");
+        fclose(out);
+    }
+    return 0;
+}
@@ -0,0 +1,127 @@
+// Converts the binary run log of dso_live to text.
+// tum:    tracked camera poses, "timestamp tx ty tz qx qy qz qw"
+// angles: relative rotations of DSO, imu and ground truth as x, y, z quaternion components,
+//         the format of the old angle_comparison.txt read by scripts/angle_comparison.py
+// imu:    csv of the preintegrated imu rotations and the gyro bias used
+// timing: csv of the tracking time per frame
+// latency: csv of the end-to-end latency per frame, logs of runs with latency=1
+//
+// usage: dso_log_convert <log> <tum|angles|imu|timing|latency> [output, default stdout]
+
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "Log/LogReader.h"
+
+using namespace dso_vi;
+
+namespace
+{
+bool isFormat(const char* format)
+{
+    return strcmp(format, "tum") == 0 || strcmp(format, "angles") == 0
+        || strcmp(format, "imu") == 0 || strcmp(format, "timing") == 0
+        || strcmp(format, "latency") == 0;
+}
+
+void writeHeader(FILE* out, const std::string &format)
+{
+    if(format == "tum")
+        fprintf(out, "# timestamp tx ty tz qx qy qz qw\n");
+    else if(format == "imu")
+        fprintf(out, "previous_timestamp,timestamp,qw,qx,qy,qz,bgx,bgy,bgz\n");
+    else if(format == "timing")
+        fprintf(out, "timestamp,track_ms,frame_id,tracked\n");
+    else if(format == "latency")
+        fprintf(out, "timestamp,latency_ms\n");
+    // angles has none, the plotting script reads every line as data
+}
+
+// false if the record isn't part of the format
+bool writeRecord(FILE* out, const std::string &format, const LogReader &reader)
+{
+    if(format == "tum")
+    {
+        LogFramePose pose;
+        if(!reader.get(pose))
+            return false;
+        fprintf(out, "%.9f %.9f %.9f %.9f %.9f %.9f %.9f %.9f\n", pose.timestamp,
+                pose.t[0], pose.t[1], pose.t[2], pose.q[1], pose.q[2], pose.q[3], pose.q[0]);
+    }
+    else if(format == "angles")
+    {
+        LogRotationComparison comparison;
+        if(!reader.get(comparison))
+            return false;
+        fprintf(out, "%g, %g, %g, %g, %g, %g, %g, %g, %g\n",
+                comparison.dso[1], comparison.dso[2], comparison.dso[3],
+                comparison.imu[1], comparison.imu[2], comparison.imu[3],
+                comparison.gt[1], comparison.gt[2], comparison.gt[3]);
+    }
+    else if(format == "imu")
+    {
+        LogImuDelta delta;
+        if(!reader.get(delta))
+            return false;
+        fprintf(out, "%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f,%.9f\n", delta.previousTimestamp, delta.timestamp,
+                delta.q[0], delta.q[1], delta.q[2], delta.q[3],
+                delta.gyroBias[0], delta.gyroBias[1], delta.gyroBias[2]);
+    }
+    else if(format == "timing")
+    {
+        LogFrameTiming timing;
+        if(!reader.get(timing))
+            return false;
+        fprintf(out, "%.9f,%.3f,%d,%d\n", timing.timestamp, timing.trackSec * 1e3, timing.frameId, timing.tracked);
+    }
+    else
+    {
+        LogFrameLatency latency;
+        if(!reader.get(latency))
+            return false;
+        fprintf(out, "%.9f,%.3f\n", latency.timestamp, latency.latencySec * 1e3);
+    }
+    return true;
+}
+}
+
+int main(int argc, char** argv)
+{
+    if(argc < 3 || !isFormat(argv[2]))
+    {
+        printf("usage: dso_log_convert <log> <tum|angles|imu|timing|latency> [output]\n");
+        return 1;
+    }
+    const std::string format = argv[2];
+
+    LogReader reader(argv[1]);
+    if(!reader.isValid())
+        return 1;
+
+    FILE* out = stdout;
+    if(argc > 3)
+    {
+        out = fopen(argv[3], "w");
+        if(!out)
+        {
+            printf("could not create %s\n", argv[3]);
+            return 1;
+        }
+    }
+
+    writeHeader(out, format);
+    unsigned long converted = 0;
+    while(reader.next())
+    {
+        if(writeRecord(out, format, reader))
+            converted++;
+    }
+
+    if(out != stdout)
+    {
+        fclose(out);
+        printf("%lu records written to %s\n", converted, argv[3]);
+    }
+    return 0;
+}
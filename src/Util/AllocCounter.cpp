@@ -0,0 +1,117 @@
+#include "AllocCounter.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include <ros/ros.h>
+
+#ifdef COUNT_ALLOCATIONS
+
+namespace
+{
+thread_local uint64_t threadAllocCnt = 0;
+
+void* countedAlloc(size_t size)
+{
+    threadAllocCnt++;
+    return std::malloc(size ? size : 1);
+}
+}
+
+void* operator new(size_t size)
+{
+    void* p = countedAlloc(size);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size)
+{
+    void* p = countedAlloc(size);
+    if(!p)
+        throw std::bad_alloc();
+    return p;
+}
+
+void* operator new(size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAlloc(size);
+}
+
+void* operator new[](size_t size, const std::nothrow_t&) noexcept
+{
+    return countedAlloc(size);
+}
+
+void operator delete(void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p) noexcept
+{
+    std::free(p);
+}
+
+void operator delete(void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+void operator delete[](void* p, const std::nothrow_t&) noexcept
+{
+    std::free(p);
+}
+
+namespace dso_vi
+{
+uint64_t getThreadAllocCnt(void) {return threadAllocCnt;}
+bool allocCountingEnabled(void) {return true;}
+}
+
+#else
+
+namespace dso_vi
+{
+uint64_t getThreadAllocCnt(void) {return 0;}
+bool allocCountingEnabled(void) {return false;}
+}
+
+#endif
+
+namespace dso_vi
+{
+
+AllocStats::AllocStats(const std::string &name, int warmupFrames):
+    _name(name), _warmupFrames(warmupFrames), _start(0), _frameCnt(0),
+    _allocFrameCnt(0), _allocCnt(0), _maxAllocCnt(0)
+{
+}
+
+void AllocStats::end(uint64_t excluded)
+{
+    const uint64_t n = getThreadAllocCnt() - _start - excluded;
+    _frameCnt++;
+    if(_frameCnt <= _warmupFrames || n == 0)
+        return;
+
+    _allocFrameCnt++;
+    _allocCnt += n;
+    if(n > _maxAllocCnt)
+        _maxAllocCnt = n;
+    ROS_WARN_THROTTLE(5.0, "%s: %lu heap allocations in frame %d", _name.c_str(), (unsigned long)n, _frameCnt);
+}
+
+void AllocStats::print(void) const
+{
+    if(!allocCountingEnabled())
+        return;
+    const int frames = _frameCnt > _warmupFrames ? _frameCnt - _warmupFrames : 0;
+    printf("%s: %d of %d steady state frames allocated, %.2f allocations per frame, max %lu\n",
+           _name.c_str(), _allocFrameCnt, frames, frames ? (double)_allocCnt / frames : 0.,
+           (unsigned long)_maxAllocCnt);
+}
+
+}
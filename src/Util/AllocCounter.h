@@ -0,0 +1,40 @@
+#ifndef ALLOCCOUNTER_H
+#define ALLOCCOUNTER_H
+
+#include <cstdint>
+#include <string>
+
+namespace dso_vi
+{
+// Heap allocations made by the calling thread. Counted by a replacement of the
+// global operator new when built with -DCOUNT_ALLOCATIONS=ON, otherwise always 0.
+// Memory that doesn't go through operator new (malloc, Eigen's aligned_malloc) isn't counted.
+uint64_t getThreadAllocCnt(void);
+bool allocCountingEnabled(void);
+
+// per frame allocations of one pipeline stage, measured on the stage's own thread.
+// The first warmupFrames frames fill the pools and buffers and are not counted.
+class AllocStats
+{
+public:
+    AllocStats(const std::string &name, int warmupFrames = 50);
+
+    void begin(void) {_start = getThreadAllocCnt();}
+    // excluded: allocations inside the stage that are not ours, e.g. inside DSO
+    void end(uint64_t excluded = 0);
+
+    void print(void) const;
+
+private:
+    std::string _name;
+    int _warmupFrames;
+    uint64_t _start;
+    int _frameCnt;
+    int _allocFrameCnt;     // steady state frames that allocated
+    uint64_t _allocCnt;
+    uint64_t _maxAllocCnt;
+};
+
+}
+
+#endif // ALLOCCOUNTER_H
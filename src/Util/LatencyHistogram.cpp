@@ -0,0 +1,83 @@
+#include "LatencyHistogram.h"
+
+#include <chrono>
+#include <cmath>
+
+namespace dso_vi
+{
+
+int64_t latencyNowNs(void)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+LatencyHistogram::LatencyHistogram():
+    _count(0), _sum(0), _max(0)
+{
+    for(int i = 0; i < bucketCnt; i++)
+        _buckets[i].store(0, std::memory_order_relaxed);
+}
+
+int LatencyHistogram::bucketIndex(int64_t ns)
+{
+    if(ns < subBucketCnt)
+        return ns < 0 ? 0 : (int)ns;
+    // the bits below the leading one select the sub bucket
+    const int msb = 63 - __builtin_clzll((unsigned long long)ns);
+    const int shift = msb - subBucketBits;
+    const int sub = (int)((ns >> shift) & (subBucketCnt - 1));
+    return (shift + 1) * subBucketCnt + sub;
+}
+
+int64_t LatencyHistogram::bucketUpperBound(int index)
+{
+    if(index < subBucketCnt)
+        return index;
+    const int shift = index / subBucketCnt - 1;
+    const int64_t lower = (int64_t)(subBucketCnt + index % subBucketCnt) << shift;
+    return lower + ((int64_t)1 << shift) - 1;
+}
+
+void LatencyHistogram::record(int64_t ns)
+{
+    _buckets[bucketIndex(ns)].fetch_add(1, std::memory_order_relaxed);
+    _count.fetch_add(1, std::memory_order_relaxed);
+    _sum.fetch_add(ns, std::memory_order_relaxed);
+
+    int64_t max = _max.load(std::memory_order_relaxed);
+    while(ns > max && !_max.compare_exchange_weak(max, ns, std::memory_order_relaxed))
+        ;
+}
+
+double LatencyHistogram::getMean(void) const
+{
+    const uint64_t count = getCount();
+    return count > 0 ? (double)_sum.load(std::memory_order_relaxed) / count : 0.0;
+}
+
+int64_t LatencyHistogram::getPercentile(double p) const
+{
+    const uint64_t count = getCount();
+    if(count == 0)
+        return 0;
+
+    uint64_t rank = (uint64_t)std::ceil(p * count);
+    if(rank < 1)
+        rank = 1;
+    uint64_t seen = 0;
+    for(int i = 0; i < bucketCnt; i++)
+    {
+        seen += _buckets[i].load(std::memory_order_relaxed);
+        if(seen >= rank)
+        {
+            // the max is exact, the bucket bound may lie above it
+            const int64_t bound = bucketUpperBound(i);
+            const int64_t max = getMax();
+            return bound < max ? bound : max;
+        }
+    }
+    return getMax();
+}
+
+}
@@ -0,0 +1,48 @@
+#ifndef LATENCYHISTOGRAM_H
+#define LATENCYHISTOGRAM_H
+
+#include <atomic>
+#include <cstdint>
+
+namespace dso_vi
+{
+// steady clock in nanoseconds, the time base of all latency stamps
+int64_t latencyNowNs(void);
+
+// HDR style histogram of latencies in nanoseconds. Values below 32ns are exact, above
+// that each power of two is split into 32 linear sub buckets, so any value up to
+// ~290 years is kept with a relative error below 1/32. Fixed size, record() never
+// allocates and is lock free; it can be read while other threads record.
+class LatencyHistogram
+{
+public:
+    LatencyHistogram();
+
+    void record(int64_t ns);
+
+    uint64_t getCount(void) const {return _count.load(std::memory_order_relaxed);}
+    int64_t getMax(void) const {return _max.load(std::memory_order_relaxed);}
+    double getMean(void) const;
+    // value at or below which a fraction p of the samples lie (upper end of its bucket)
+    int64_t getPercentile(double p) const;
+
+private:
+    LatencyHistogram(const LatencyHistogram&);
+    LatencyHistogram& operator=(const LatencyHistogram&);
+
+    static const int subBucketBits = 5;
+    static const int subBucketCnt = 1 << subBucketBits;
+    static const int bucketCnt = (64 - subBucketBits) * subBucketCnt;
+
+    static int bucketIndex(int64_t ns);
+    static int64_t bucketUpperBound(int index);
+
+    std::atomic<uint64_t> _buckets[bucketCnt];
+    std::atomic<uint64_t> _count;
+    std::atomic<int64_t> _sum;
+    std::atomic<int64_t> _max;
+};
+
+}
+
+#endif // LATENCYHISTOGRAM_H